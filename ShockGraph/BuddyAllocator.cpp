@@ -0,0 +1,130 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "BuddyAllocator.hpp"
+
+#include <EASTL/algorithm.h>
+#include <libassert/assert.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        static constexpr bool IsPowerOfTwo(usize value) {
+            return value != 0 && (value & (value - 1)) == 0;
+        }
+
+        BuddyAllocator::BuddyAllocator(usize size, usize minBlockSize)
+            : mSize(size), mMinBlockSize(minBlockSize) {
+            ASSERT(IsPowerOfTwo(size) && IsPowerOfTwo(minBlockSize) && minBlockSize <= size, "Buddy allocator sizes must be powers of two!");
+            const usize blockCount = size / minBlockSize;
+            while ((usize(1) << mMaxOrder) < blockCount) {
+                ++mMaxOrder;
+            }
+            ASSERT(mMaxOrder < FREE_BLOCK_FLAG - 1, "Too many block orders!");
+            mFreeHeads.resize(mMaxOrder + 1, NULL_BLOCK);
+            mBlockStates.resize(blockCount, 0);
+            mNext.resize(blockCount, NULL_BLOCK);
+            mPrev.resize(blockCount, NULL_BLOCK);
+            PushFree(0, mMaxOrder);
+        }
+
+        usize BuddyAllocator::Allocate(usize size) {
+            const u32 order = OrderOf(size);
+            if (order > mMaxOrder) {
+                return INVALID_OFFSET;
+            }
+            u32 freeOrder = order;
+            while (freeOrder <= mMaxOrder && mFreeHeads[freeOrder] == NULL_BLOCK) {
+                ++freeOrder;
+            }
+            if (freeOrder > mMaxOrder) {
+                return INVALID_OFFSET;
+            }
+            const u32 block = mFreeHeads[freeOrder];
+            RemoveFree(block, freeOrder);
+            // split down to the requested order, the upper halves stay free
+            while (freeOrder > order) {
+                --freeOrder;
+                PushFree(block + (1U << freeOrder), freeOrder);
+            }
+            mBlockStates[block] = static_cast<u8>(order + 1);
+            mUsedBytes += mMinBlockSize << order;
+            ++mAllocationCount;
+            return block * mMinBlockSize;
+        }
+
+        void BuddyAllocator::Free(usize offset) {
+            ASSERT(offset % mMinBlockSize == 0 && offset < mSize, "Offset was not allocated from this allocator!");
+            u32 block = static_cast<u32>(offset / mMinBlockSize);
+            ASSERT(mBlockStates[block] != 0 && !(mBlockStates[block] & FREE_BLOCK_FLAG), "Double free!");
+            u32 order = mBlockStates[block] - 1U;
+            mBlockStates[block] = 0;
+            mUsedBytes -= mMinBlockSize << order;
+            --mAllocationCount;
+            // merge with the buddy for as long as it is free and whole
+            while (order < mMaxOrder) {
+                const u32 buddy = block ^ (1U << order);
+                if (mBlockStates[buddy] != (FREE_BLOCK_FLAG | (order + 1))) {
+                    break;
+                }
+                RemoveFree(buddy, order);
+                block = eastl::min(block, buddy);
+                ++order;
+            }
+            PushFree(block, order);
+        }
+
+        u32 BuddyAllocator::OrderOf(usize size) const {
+            u32 order = 0;
+            while ((mMinBlockSize << order) < size) {
+                ++order;
+                if (order > mMaxOrder) {
+                    break;
+                }
+            }
+            return order;
+        }
+
+        void BuddyAllocator::PushFree(u32 block, u32 order) {
+            mBlockStates[block] = static_cast<u8>(FREE_BLOCK_FLAG | (order + 1));
+            mPrev[block] = NULL_BLOCK;
+            mNext[block] = mFreeHeads[order];
+            if (mFreeHeads[order] != NULL_BLOCK) {
+                mPrev[mFreeHeads[order]] = block;
+            }
+            mFreeHeads[order] = block;
+        }
+
+        void BuddyAllocator::RemoveFree(u32 block, u32 order) {
+            if (mPrev[block] != NULL_BLOCK) {
+                mNext[mPrev[block]] = mNext[block];
+            } else {
+                mFreeHeads[order] = mNext[block];
+            }
+            if (mNext[block] != NULL_BLOCK) {
+                mPrev[mNext[block]] = mPrev[block];
+            }
+            mBlockStates[block] = 0;
+            mNext[block] = NULL_BLOCK;
+            mPrev[block] = NULL_BLOCK;
+        }
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,72 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <EASTL/vector.h>
+#include <ShockGraph/Core.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        /**
+         * @brief Power of two block allocator over a fixed range, blocks are aligned to their own size.
+         * Allocation and free are O(log n), the bookkeeping lives outside of the managed memory. Not thread safe.
+         */
+        class BuddyAllocator {
+        public:
+            static constexpr usize INVALID_OFFSET = ~usize(0);
+
+            /**
+             * @brief size and minBlockSize must be powers of two, minBlockSize at most size.
+             */
+            BuddyAllocator() = default;
+            BuddyAllocator(usize size, usize minBlockSize);
+
+            PYRO_NODISCARD usize Allocate(usize size);
+            void Free(usize offset);
+
+            PYRO_NODISCARD PYRO_FORCEINLINE usize Size() const { return mSize; }
+            PYRO_NODISCARD PYRO_FORCEINLINE usize UsedBytes() const { return mUsedBytes; }
+            PYRO_NODISCARD PYRO_FORCEINLINE u32 AllocationCount() const { return mAllocationCount; }
+
+        private:
+            static constexpr u32 NULL_BLOCK = ~0U;
+            static constexpr u8 FREE_BLOCK_FLAG = 0x80;
+
+            PYRO_NODISCARD u32 OrderOf(usize size) const;
+            void PushFree(u32 block, u32 order);
+            void RemoveFree(u32 block, u32 order);
+
+            usize mSize = 0;
+            usize mMinBlockSize = 0;
+            u32 mMaxOrder = 0;
+            usize mUsedBytes = 0;
+            u32 mAllocationCount = 0;
+            // heads of the doubly linked free lists, one per order
+            eastl::vector<u32> mFreeHeads = {};
+            // per minimum sized block: order + 1 of the block starting there (0 if none), FREE_BLOCK_FLAG while free
+            eastl::vector<u8> mBlockStates = {};
+            eastl::vector<u32> mNext = {};
+            eastl::vector<u32> mPrev = {};
+        };
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,78 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "Task.hpp"
+#include <EASTL/span.h>
+#include <EASTL/vector.h>
+#include <ShockGraph/Core.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        using TaskId = u32;
+        using TaskSchedule = eastl::vector<eastl::vector<TaskId>>;
+
+        struct TaskScheduleNode {
+            TaskType type = TaskType::None;
+            /**
+             * @brief Last measured GPU time of the task, 0.0 if it was never measured.
+             */
+            f64 weightNs = 0.0;
+            /**
+             * @brief Number of barriers the task needs before it can run. The order in which a resource
+             * is used is fixed by the dependencies, so this does not change between legal schedules.
+             */
+            u32 barrierCount = 0;
+            eastl::span<const TaskId> dependencies = {};
+            eastl::span<const TaskId> dependents = {};
+        };
+
+        struct TaskScheduleInfo {
+            /**
+             * @brief One node per task, indexed by TaskId.
+             */
+            eastl::span<const TaskScheduleNode> tasks = {};
+        };
+
+        struct ITaskScheduler {
+            SHOCKGRAPH_API ITaskScheduler() = default;
+            SHOCKGRAPH_API virtual ~ITaskScheduler() = default;
+
+            /**
+             * @brief Orders the tasks of a graph into batches.
+             * @param batches On input, the as-soon-as-possible batching of the graph. On output, every task of the input
+             * must appear exactly once, in a later batch than all of its dependencies. Tasks run in the order given.
+             * Tasks that are not part of the input belong to another variant of the graph and must not be scheduled.
+             */
+            virtual void Schedule(const TaskScheduleInfo& info, TaskSchedule& batches) = 0;
+            /**
+             * @brief Stable name of the scheduler, schedule caches are only reused by a scheduler with the same name and version.
+             */
+            PYRO_NODISCARD virtual const char* GetName() const = 0;
+            /**
+             * @brief Bump whenever the schedules produced for the same input change, so stale caches are rebuilt.
+             */
+            PYRO_NODISCARD virtual u32 GetVersion() const { return 0; }
+        };
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -133,7 +133,10 @@ namespace PyroshockStudios {
         }
         TaskBuffer_::~TaskBuffer_() {
             Owner()->ReleaseBufferResource(this);
-            if (this->mInfo.mode == TaskBufferMode::HostDynamic || this->mInfo.mode == TaskBufferMode::Readback) {
+            if (IsSuballocated()) {
+                // the heap outlives its suballocations, the range is reused once the GPU is done with it
+                Owner()->FreeBufferSuballocation(mHeap, mHeapOffset, mInfo.size);
+            } else if (this->mInfo.mode == TaskBufferMode::HostDynamic || this->mInfo.mode == TaskBufferMode::Readback) {
                 // Do not destroy mBuffer as it is the same stuff as in mInFlightBuffers!
             } else {
                 Device()->DestroyDeferred(mBuffer);
@@ -145,7 +148,7 @@ namespace PyroshockStudios {
             }
         }
         void* TaskBuffer_::MapMemory(const BufferRegion& region) {
-            return Device()->BufferHostAddress(InternalInFlightBuffer(mCurrentBufferInFlight)) + region.offset;
+            return Device()->BufferHostAddress(InternalInFlightBuffer(mCurrentBufferInFlight)) + mHeapOffset + region.offset;
         }
         void TaskBuffer_::UnmapMemory(void* memory) {
         }
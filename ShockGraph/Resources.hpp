@@ -35,6 +35,7 @@
 #include <PyroRHI/Api/Types.hpp>
 #include <PyroRHI/Shader/ShaderProgram.hpp>
 #include <ShockGraph/Core.hpp>
+#include <atomic>
 #include <mutex>
 
 namespace PyroshockStudios {
@@ -208,6 +209,18 @@ namespace PyroshockStudios {
                 return mInFlightBuffers.size() == 1 ? mInFlightBuffers.front() : mInFlightBuffers[index];
             }
             PYRO_NODISCARD PYRO_FORCEINLINE const TaskBufferInfo& Info() const { return mInfo; }
+            /**
+             * @brief Range of Internal() the buffer occupies. The offset is only non-zero for buffers suballocated from a heap,
+             * see TaskResourceManagerInfo::bufferHeapSize, views and raw commands on Internal() must add it.
+             */
+            PYRO_NODISCARD PYRO_FORCEINLINE BufferRegion Region() const {
+                return { .offset = mHeapOffset, .size = mInfo.size };
+            }
+            PYRO_NODISCARD PYRO_FORCEINLINE bool IsSuballocated() const { return mHeap != ~0U; }
+            /**
+             * @brief False while the initial data is still queued for upload, see TaskResourceManager::MakeResident().
+             */
+            PYRO_NODISCARD PYRO_FORCEINLINE bool IsResident() const { return mbResident.load(std::memory_order_acquire); }
 
             PYRO_NODISCARD SHOCKGRAPH_API void* MapMemory(const BufferRegion& region = {});
             SHOCKGRAPH_API void UnmapMemory(void* memory);
@@ -216,6 +229,14 @@ namespace PyroshockStudios {
             Buffer mBuffer = PYRO_NULL_BUFFER;
             eastl::vector<Buffer> mInFlightBuffers = {};
             u32 mCurrentBufferInFlight = 0;
+            // heap mBuffer was suballocated from, ~0U for a dedicated allocation
+            u32 mHeap = ~0U;
+            usize mHeapOffset = 0;
+            // views were created from the raw handle, task graphs cannot swap the allocation underneath
+            bool mbHasExternalViews = false;
+            // task graphs that rename this resource, raw handle views cannot be created while any is built
+            std::atomic<u32> mVersioningGraphs = 0;
+            std::atomic<bool> mbResident = true;
 
             TaskBufferInfo mInfo;
 
@@ -234,6 +255,12 @@ namespace PyroshockStudios {
             u32 arrayLayerCount = 1;
             RasterizationSamples sampleCount = RasterizationSamples::e1;
             ImageUsageFlags usage = {};
+            /**
+             * @brief Generates every mip level after the first from mip 0 once the initial data is uploaded,
+             * see TaskResourceManager::SetMipGenerationPipeline(). Only mip 0 of each layer is read from the initial data.
+             * Only R8Unorm, RG8Unorm, RGBA8Unorm, RGBA16Sfloat, RG32Sfloat and RGBA32Sfloat images can generate their mips.
+             */
+            bool bGenerateMips = false;
             eastl::string name = {};
         };
         struct TaskImage_ final : public TaskResource_ {
@@ -247,6 +274,10 @@ namespace PyroshockStudios {
             }
 
             PYRO_NODISCARD PYRO_FORCEINLINE const TaskImageInfo& Info() const { return mInfo; }
+            /**
+             * @brief False while the initial data is still queued for upload, see TaskResourceManager::MakeResident().
+             */
+            PYRO_NODISCARD PYRO_FORCEINLINE bool IsResident() const { return mbResident.load(std::memory_order_acquire); }
             PYRO_NODISCARD PYRO_FORCEINLINE ImageMipArraySlice Slice() const {
                 return {
                     .baseMipLevel = 0,
@@ -267,9 +298,15 @@ namespace PyroshockStudios {
             mutable UnorderedAccessId uavId;
             Image mCurrentImage = PYRO_NULL_IMAGE;
             struct TaskSwapChain_* mSwapChainOwner = nullptr;
+            // views were created from the raw handle, task graphs cannot swap the allocation underneath
+            bool mbHasExternalViews = false;
+            // task graphs that rename this resource, raw handle views cannot be created while any is built
+            std::atomic<u32> mVersioningGraphs = 0;
+            std::atomic<bool> mbResident = true;
             TaskImageInfo mInfo;
 
             friend struct TaskColorTarget_;
+            friend class TaskCommandList;
             friend class TaskResourceManager;
             friend class TaskGraph;
         };
@@ -0,0 +1,192 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "StagingCopyPool.hpp"
+
+#include <EASTL/algorithm.h>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHOCKGRAPH_STREAMING_STORES 1
+#else
+#define SHOCKGRAPH_STREAMING_STORES 0
+#endif
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        // copies smaller than this are not worth waking the workers for
+        constexpr usize PARALLEL_COPY_THRESHOLD = 4 * 1024 * 1024;
+        constexpr usize PARALLEL_COPY_CHUNK_SIZE = 1024 * 1024;
+        // below this the alignment head and tail dominate, a plain memcpy is as fast
+        constexpr usize STREAMING_COPY_MIN_SIZE = 256;
+
+        static void StreamCopy(u8* dst, const u8* src, usize size) {
+#if SHOCKGRAPH_STREAMING_STORES
+            if (size >= STREAMING_COPY_MIN_SIZE) {
+                // staging memory is write-combined, full aligned lines skip the cache and the read for ownership
+                const usize head = (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+                memcpy(dst, src, head);
+                dst += head;
+                src += head;
+                size -= head;
+                for (; size >= 64; size -= 64, dst += 64, src += 64) {
+                    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+                    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+                    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+                    _mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+                    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+                    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+                    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+                }
+                for (; size >= 16; size -= 16, dst += 16, src += 16) {
+                    _mm_stream_si128(reinterpret_cast<__m128i*>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+                }
+            }
+#endif
+            memcpy(dst, src, size);
+        }
+
+        static void CopyRegion(const StagingCopyRegion& region) {
+            if (region.srcRowPitch == region.rowSize && region.dstRowPitch == region.rowSize) {
+                StreamCopy(region.dst, region.src, region.rowSize * region.rowCount);
+                return;
+            }
+            for (usize row = 0; row < region.rowCount; ++row) {
+                StreamCopy(region.dst + row * region.dstRowPitch, region.src + row * region.srcRowPitch, region.rowSize);
+            }
+        }
+
+        StagingCopyPool::StagingCopyPool(u32 workerCount) {
+            mWorkers.reserve(workerCount);
+            for (u32 i = 0; i < workerCount; ++i) {
+                mWorkers.emplace_back([this] { WorkerMain(); });
+            }
+        }
+        StagingCopyPool::~StagingCopyPool() {
+            {
+                std::lock_guard l(mLock);
+                mbStop = true;
+            }
+            mWorkAvailable.notify_all();
+            for (std::thread& worker : mWorkers) {
+                worker.join();
+            }
+        }
+
+        void StagingCopyPool::Copy(eastl::span<const StagingCopyRegion> regions) {
+            usize totalSize = 0;
+            for (const StagingCopyRegion& region : regions) {
+                totalSize += region.rowSize * region.rowCount;
+            }
+            if (mWorkers.empty() || totalSize < PARALLEL_COPY_THRESHOLD) {
+                for (const StagingCopyRegion& region : regions) {
+                    CopyRegion(region);
+                }
+#if SHOCKGRAPH_STREAMING_STORES
+                _mm_sfence();
+#endif
+                return;
+            }
+
+            // split into chunks of whole rows, or byte ranges of contiguous data
+            eastl::vector<StagingCopyRegion> chunks = {};
+            chunks.reserve(totalSize / PARALLEL_COPY_CHUNK_SIZE + regions.size());
+            for (const StagingCopyRegion& region : regions) {
+                const bool bContiguous = region.srcRowPitch == region.rowSize && region.dstRowPitch == region.rowSize;
+                if (bContiguous || region.rowCount == 1) {
+                    const usize size = region.rowSize * region.rowCount;
+                    for (usize offset = 0; offset < size; offset += PARALLEL_COPY_CHUNK_SIZE) {
+                        const usize chunkSize = eastl::min(PARALLEL_COPY_CHUNK_SIZE, size - offset);
+                        chunks.push_back({
+                            .src = region.src + offset,
+                            .dst = region.dst + offset,
+                            .srcRowPitch = chunkSize,
+                            .dstRowPitch = chunkSize,
+                            .rowSize = chunkSize,
+                        });
+                    }
+                } else {
+                    const usize rowsPerChunk = eastl::max(PARALLEL_COPY_CHUNK_SIZE / region.rowSize, usize(1));
+                    for (usize row = 0; row < region.rowCount; row += rowsPerChunk) {
+                        StagingCopyRegion chunk = region;
+                        chunk.src += row * region.srcRowPitch;
+                        chunk.dst += row * region.dstRowPitch;
+                        chunk.rowCount = eastl::min(rowsPerChunk, region.rowCount - row);
+                        chunks.push_back(chunk);
+                    }
+                }
+            }
+
+            Batch batch = {};
+            batch.chunks = chunks;
+            {
+                std::lock_guard l(mLock);
+                mBatches.push_back(&batch);
+            }
+            mWorkAvailable.notify_all();
+            // the calling thread copies too, so a busy pool never makes the copy slower than a serial one
+            CopyChunks(batch);
+
+            std::unique_lock l(mLock);
+            auto it = eastl::find(mBatches.begin(), mBatches.end(), &batch);
+            if (it != mBatches.end()) {
+                mBatches.erase(it);
+            }
+            mBatchReleased.wait(l, [&batch] { return batch.users == 0; });
+        }
+
+        void StagingCopyPool::CopyChunks(Batch& batch) {
+            for (usize i = batch.next.fetch_add(1, std::memory_order_relaxed); i < batch.chunks.size(); i = batch.next.fetch_add(1, std::memory_order_relaxed)) {
+                CopyRegion(batch.chunks[i]);
+            }
+#if SHOCKGRAPH_STREAMING_STORES
+            // streaming stores are weakly ordered, they must land before the upload is handed to a task graph
+            _mm_sfence();
+#endif
+        }
+
+        void StagingCopyPool::WorkerMain() {
+            std::unique_lock l(mLock);
+            while (true) {
+                mWorkAvailable.wait(l, [this] { return mbStop || !mBatches.empty(); });
+                if (mbStop) {
+                    return;
+                }
+                Batch* batch = mBatches.front();
+                ++batch->users;
+                l.unlock();
+                CopyChunks(*batch);
+                l.lock();
+                // every chunk is taken, later workers must not pick the batch up again
+                auto it = eastl::find(mBatches.begin(), mBatches.end(), batch);
+                if (it != mBatches.end()) {
+                    mBatches.erase(it);
+                }
+                --batch->users;
+                mBatchReleased.notify_all();
+            }
+        }
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,75 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <EASTL/functional.h>
+#include <EASTL/span.h>
+#include <EASTL/vector.h>
+#include <ShockGraph/Core.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        struct StagingCopyRegion {
+            const u8* src = nullptr;
+            u8* dst = nullptr;
+            usize srcRowPitch = 0;
+            usize dstRowPitch = 0;
+            usize rowSize = 0;
+            usize rowCount = 1;
+        };
+
+        /**
+         * @brief Copies initial data into write-combined staging memory with streaming stores.
+         * Large copies are split into chunks shared between the calling thread and a small worker pool,
+         * so several threads may copy at once without waiting on each other's uploads.
+         */
+        class StagingCopyPool : DeleteCopy, DeleteMove {
+        public:
+            StagingCopyPool(u32 workerCount);
+            ~StagingCopyPool();
+
+            void Copy(eastl::span<const StagingCopyRegion> regions);
+
+        private:
+            struct Batch {
+                eastl::span<const StagingCopyRegion> chunks = {};
+                std::atomic<usize> next = 0;
+                // workers still inside the batch, guarded by mLock
+                u32 users = 0;
+            };
+            static void CopyChunks(Batch& batch);
+            void WorkerMain();
+
+            eastl::vector<std::thread> mWorkers = {};
+            std::mutex mLock = {};
+            std::condition_variable mWorkAvailable = {};
+            std::condition_variable mBatchReleased = {};
+            eastl::vector<Batch*> mBatches = {};
+            bool mbStop = false;
+        };
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
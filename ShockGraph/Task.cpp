@@ -74,6 +74,15 @@ namespace PyroshockStudios {
             mSetupData.imageDepends.clear();
             mSetupData.accelerationStructureDepends.clear();
         }
+        void GenericTask::SetEnabled(bool bEnabled) {
+            mbEnabled = bEnabled;
+        }
+        void GenericTask::SetEnablePredicate(eastl::function<bool()>&& predicate) {
+            mEnablePredicate = eastl::move(predicate);
+        }
+        bool GenericTask::EvaluateEnabled() {
+            return mbEnabled && (!mEnablePredicate || mEnablePredicate());
+        }
 
 
         void CustomTask::ExecuteTask(TaskCommandList& commandList) {
@@ -25,6 +25,7 @@
 #include "Resources.hpp"
 #include <EASTL/array.h>
 #include <EASTL/fixed_vector.h>
+#include <EASTL/functional.h>
 #include <EASTL/optional.h>
 #include <EASTL/string.h>
 #include <PyroRHI/Api/Types.hpp>
@@ -94,11 +95,27 @@ namespace PyroshockStudios {
 
             SHOCKGRAPH_API void Reset();
 
+            /**
+             * @brief Skips the task while disabled, without rebuilding the graph. Barriers of a skipped task are
+             * folded into the next barrier of the resource. Tasks depending on it still run on the previous contents,
+             * including render targets it would have cleared.
+             */
+            SHOCKGRAPH_API void SetEnabled(bool bEnabled);
+            /**
+             * @brief Evaluated once per frame by Execute(), the task is skipped when it returns false. Pass an empty function to remove it.
+             */
+            SHOCKGRAPH_API void SetEnablePredicate(eastl::function<bool()>&& predicate);
+
             PYRO_NODISCARD PYRO_FORCEINLINE const TaskInfo& Info() const {
                 return mTaskInfo;
             }
+            PYRO_NODISCARD PYRO_FORCEINLINE bool IsEnabled() const {
+                return mbEnabled;
+            }
 
         private:
+            PYRO_NODISCARD bool EvaluateEnabled();
+
             struct GenericSetup {
                 eastl::vector<TaskBufferDependencyInfo> bufferDepends;
                 eastl::vector<TaskImageDependencyInfo> imageDepends;
@@ -107,6 +124,8 @@ namespace PyroshockStudios {
 
             GenericSetup mSetupData = {};
             TaskInfo mTaskInfo = {};
+            eastl::function<bool()> mEnablePredicate = {};
+            bool mbEnabled = true;
 
             friend class TaskGraph;
         };
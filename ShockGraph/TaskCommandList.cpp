@@ -22,7 +22,37 @@
 
 #include "TaskCommandList.hpp"
 
+#include <libassert/assert.hpp>
+
 namespace PyroshockStudios {
     inline namespace ShockGraph {
+        TaskTransientUniform TaskCommandList::AllocateTransientUniform(usize size) {
+            ASSERT(mTransientUniforms, "Transient uniforms are only available to command lists recorded by a task graph!");
+            return mTransientUniforms->Allocate(size);
+        }
+        ShaderResourceId TaskCommandList::ShaderResource(TaskImageRef image) {
+            TaskShadowResource* shadow = FindShadow(nullptr, image.Get());
+            if (!shadow) {
+                return image->ShaderResource();
+            }
+            if (shadow->srv == PYRO_NULL_SRV) {
+                ImageResourceInfo info = image->GetDefaultResourceInfo();
+                info.image = shadow->image;
+                shadow->srv = mOwningDevice.CreateShaderResource(info);
+            }
+            return shadow->srv;
+        }
+        UnorderedAccessId TaskCommandList::UnorderedAccess(TaskImageRef image) {
+            TaskShadowResource* shadow = FindShadow(nullptr, image.Get());
+            if (!shadow) {
+                return image->UnorderedAccess();
+            }
+            if (shadow->uav == PYRO_NULL_UAV) {
+                ImageResourceInfo info = image->GetDefaultResourceInfo();
+                info.image = shadow->image;
+                shadow->uav = mOwningDevice.CreateUnorderedAccess(info);
+            }
+            return shadow->uav;
+        }
     }
 } // namespace PyroshockStudios
\ No newline at end of file
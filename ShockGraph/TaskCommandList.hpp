@@ -23,8 +23,10 @@
 #pragma once
 
 #include "Resources.hpp"
+#include "TransientUniformPool.hpp"
 #include <PyroRHI/Api/ICommandBuffer.hpp>
 #include <PyroRHI/Api/IDevice.hpp>
+#include <cstring>
 
 namespace PyroshockStudios {
     inline namespace ShockGraph {
@@ -63,6 +65,11 @@ namespace PyroshockStudios {
             TaskBufferRef buffer;
         };
 
+        struct TaskSetTransientUniformBufferViewInfo {
+            u32 slot = {};
+            TaskTransientUniform uniform = {};
+        };
+
         struct TaskSetUnorderedAccessViewInfo {
             u32 slot = {};
             UnorderedAccessId view = {};
@@ -125,23 +132,38 @@ namespace PyroshockStudios {
             eastl::span<const TaskBlasBuildInfo> blasBuildInfos = {};
         };
 
+        /**
+         * @brief Allocation backing a renamed version of a buffer or image, see TaskGraphInfo::bResourceVersioning.
+         */
+        struct TaskShadowResource {
+            Buffer buffer = PYRO_NULL_BUFFER;
+            Image image = PYRO_NULL_IMAGE;
+            ShaderResourceId srv = PYRO_NULL_SRV;
+            UnorderedAccessId uav = PYRO_NULL_UAV;
+        };
+        struct TaskShadowBinding {
+            const TaskBuffer_* buffer = nullptr;
+            const TaskImage_* image = nullptr;
+            u32 shadowIndex = ~0U;
+        };
+
         class TaskCommandList : DeleteCopy, DeleteMove {
         public:
             TaskCommandList(IDevice& owningDevice, ICommandBuffer& commandBuffer)
                 : mOwningDevice(owningDevice), mCommandBuffer(commandBuffer) {}
             PYRO_FORCEINLINE void CopyBuffer(const TaskCopyBufferInfo& info) {
                 mCommandBuffer.CopyBufferToBuffer({
-                    .srcBuffer = info.srcBuffer->Internal(),
-                    .dstBuffer = info.dstBuffer->Internal(),
-                    .srcOffset = info.srcOffset,
-                    .dstOffset = info.dstOffset,
+                    .srcBuffer = Resolve(info.srcBuffer.Get()),
+                    .dstBuffer = Resolve(info.dstBuffer.Get()),
+                    .srcOffset = info.srcBuffer->Region().offset + info.srcOffset,
+                    .dstOffset = info.dstBuffer->Region().offset + info.dstOffset,
                     .size = info.size,
                 });
             }
             PYRO_FORCEINLINE void CopyImage(const TaskCopyImageInfo& info) {
                 mCommandBuffer.CopyImageToImage({
-                    .srcImage = info.srcImage->Internal(),
-                    .dstImage = info.dstImage->Internal(),
+                    .srcImage = Resolve(info.srcImage.Get()),
+                    .dstImage = Resolve(info.dstImage.Get()),
                     .srcImageSlice = info.srcImageSlice,
                     .srcOffset = info.srcOffset,
                     .dstImageSlice = info.dstImageSlice,
@@ -153,8 +175,11 @@ namespace PyroshockStudios {
             }
             PYRO_FORCEINLINE void UpdateBuffer(const TaskUpdateBufferInfo& info) {
                 mCommandBuffer.UpdateBuffer({
-                    .buffer = info.buffer->Internal(),
-                    .region = info.region,
+                    .buffer = Resolve(info.buffer.Get()),
+                    .region = {
+                        .offset = info.buffer->Region().offset + info.region.offset,
+                        .size = info.region.size,
+                    },
                     .data = info.data,
                 });
             }
@@ -168,10 +193,34 @@ namespace PyroshockStudios {
             PYRO_FORCEINLINE void SetUniformBufferView(const TaskSetUniformBufferViewInfo& info) {
                 mCommandBuffer.SetUniformBufferView({
                     .slot = info.slot,
-                    .buffer = info.buffer->Internal(),
+                    .buffer = Resolve(info.buffer.Get()),
                     .bindPoint = mCurrBindPoint,
                 });
             }
+            /**
+             * @brief Hands out a host visible uniform buffer of at least size bytes that stays valid until the end of the frame.
+             * Only available to tasks recorded by a task graph, the buffer is reused once the frame retires.
+             */
+            PYRO_NODISCARD SHOCKGRAPH_API TaskTransientUniform AllocateTransientUniform(usize size);
+            PYRO_FORCEINLINE void SetTransientUniformBufferView(const TaskSetTransientUniformBufferViewInfo& info) {
+                mCommandBuffer.SetUniformBufferView({
+                    .slot = info.slot,
+                    .buffer = info.uniform.buffer,
+                    .bindPoint = mCurrBindPoint,
+                });
+            }
+            /**
+             * @brief Copies data into a transient uniform buffer and binds it to slot.
+             * Every call takes its own buffer of the next power of two size (256 bytes at least) for the whole frame, so each frame in flight keeps
+             * as many buffers as calls in its busiest recent frame. Batch constants into one struct per draw instead of several small calls.
+             */
+            template <StandardLayoutConcept T>
+            PYRO_FORCEINLINE void SetUniformData(u32 slot, const T& data) {
+                static_assert(sizeof(T) <= Limits::MAX_UNIFORM_BUFFER_SIZE, "Uniform data is too large! Please use a shader resource instead!");
+                TaskTransientUniform uniform = AllocateTransientUniform(sizeof(T));
+                memcpy(uniform.hostAddress, &data, sizeof(T));
+                SetTransientUniformBufferView({ .slot = slot, .uniform = uniform });
+            }
             PYRO_FORCEINLINE void SetUnorderedAccessView(const TaskSetUnorderedAccessViewInfo& info) {
                 mCommandBuffer.SetUnorderedAccessView({
                     .slot = info.slot,
@@ -198,14 +247,14 @@ namespace PyroshockStudios {
             PYRO_FORCEINLINE void SetVertexBuffer(const TaskSetVertexBufferInfo& info) {
                 mCommandBuffer.SetVertexBuffer({
                     .slot = info.slot,
-                    .buffer = info.buffer->Internal(),
-                    .offset = info.offset,
+                    .buffer = Resolve(info.buffer.Get()),
+                    .offset = info.buffer->Region().offset + info.offset,
                 });
             }
             PYRO_FORCEINLINE void SetIndexBuffer(const TaskSetIndexBufferInfo& info) {
                 mCommandBuffer.SetIndexBuffer({
-                    .buffer = info.buffer->Internal(),
-                    .offset = info.offset,
+                    .buffer = Resolve(info.buffer.Get()),
+                    .offset = info.buffer->Region().offset + info.offset,
                     .indexType = info.indexType,
                 });
             }
@@ -218,16 +267,16 @@ namespace PyroshockStudios {
             }
             PYRO_FORCEINLINE void DrawIndirect(const TaskDrawIndirectInfo& info) {
                 mCommandBuffer.DrawIndirect({
-                    .indirectBuffer = info.indirectBuffer->Internal(),
-                    .indirectBufferOffset = info.indirectBufferOffset,
+                    .indirectBuffer = Resolve(info.indirectBuffer.Get()),
+                    .indirectBufferOffset = info.indirectBuffer->Region().offset + info.indirectBufferOffset,
                     .drawCount = info.drawCount,
                     .drawCommandStride = info.drawCommandStride,
                 });
             }
             PYRO_FORCEINLINE void DrawIndexedIndirect(const TaskDrawIndexedIndirectInfo& info) {
                 mCommandBuffer.DrawIndexedIndirect({
-                    .indirectBuffer = info.indirectBuffer->Internal(),
-                    .indirectBufferOffset = info.indirectBufferOffset,
+                    .indirectBuffer = Resolve(info.indirectBuffer.Get()),
+                    .indirectBufferOffset = info.indirectBuffer->Region().offset + info.indirectBufferOffset,
                     .drawCount = info.drawCount,
                     .drawCommandStride = info.drawCommandStride,
                 });
@@ -238,8 +287,8 @@ namespace PyroshockStudios {
             }
             PYRO_FORCEINLINE void DispatchIndirect(const TaskDispatchIndirectInfo& info) {
                 mCommandBuffer.DrawIndexedIndirect({
-                    .indirectBuffer = info.indirectBuffer->Internal(),
-                    .indirectBufferOffset = info.indirectBufferOffset,
+                    .indirectBuffer = Resolve(info.indirectBuffer.Get()),
+                    .indirectBufferOffset = info.indirectBuffer->Region().offset + info.indirectBufferOffset,
                 });
             }
 
@@ -277,11 +326,35 @@ namespace PyroshockStudios {
                 });
             }
 
+            /**
+             * @brief Views of the version of image this task records with. A task graph with resource versioning can hand
+             * a task a renamed allocation, so views bound in a task should come from here instead of TaskImage_::ShaderResource().
+             */
+            PYRO_NODISCARD SHOCKGRAPH_API ShaderResourceId ShaderResource(TaskImageRef image);
+            PYRO_NODISCARD SHOCKGRAPH_API UnorderedAccessId UnorderedAccess(TaskImageRef image);
+
             PYRO_FORCEINLINE ICommandBuffer* Internal() {
                 return &mCommandBuffer;
             }
 
         private:
+            PYRO_NODISCARD PYRO_FORCEINLINE TaskShadowResource* FindShadow(const TaskBuffer_* buffer, const TaskImage_* image) {
+                for (const TaskShadowBinding& binding : mShadowBindings) {
+                    if (binding.buffer == buffer && binding.image == image) {
+                        return &mShadowResources[binding.shadowIndex];
+                    }
+                }
+                return nullptr;
+            }
+            PYRO_NODISCARD PYRO_FORCEINLINE Buffer Resolve(TaskBuffer_* buffer) {
+                const TaskShadowResource* shadow = FindShadow(buffer, nullptr);
+                return shadow ? shadow->buffer : buffer->Internal();
+            }
+            PYRO_NODISCARD PYRO_FORCEINLINE Image Resolve(TaskImage_* image) {
+                const TaskShadowResource* shadow = FindShadow(nullptr, image);
+                return shadow ? shadow->image : image->Internal();
+            }
+
             template <typename Pipeline>
             PYRO_FORCEINLINE void RefreshPipelineIf(Pipeline& pipeline) {
                 if (!pipeline->mbDirty)
@@ -292,6 +365,10 @@ namespace PyroshockStudios {
             }
 
             PipelineBindPoint mCurrBindPoint = {};
+            TransientUniformPool* mTransientUniforms = nullptr;
+            // renamed resources of the task being recorded, set by the task graph
+            eastl::span<const TaskShadowBinding> mShadowBindings = {};
+            TaskShadowResource* mShadowResources = nullptr;
             ICommandBuffer& mCommandBuffer;
             IDevice& mOwningDevice;
 
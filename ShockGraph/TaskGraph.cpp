@@ -21,6 +21,8 @@
 // SOFTWARE.
 
 #include "TaskGraph.hpp"
+#include "TaskMipGeneration.hpp"
+#include "TaskScheduler.hpp"
 #include <PyroCommon/Logger.hpp>
 #include <PyroRHI/Api/ICommandQueue.hpp>
 #include <PyroRHI/Api/IDevice.hpp>
@@ -28,6 +30,7 @@
 #include <PyroRHI/ToString.hpp>
 
 #include <EASTL/algorithm.h>
+#include <EASTL/hash_map.h>
 #include <EASTL/hash_set.h>
 #include <EASTL/numeric.h>
 #include <EASTL/sort.h>
@@ -36,6 +39,8 @@
 namespace PyroshockStudios {
     inline namespace ShockGraph {
         constexpr u32 RESERVED_SWAPCHAIN_WRITE_FLAG = 0x01;
+        constexpr u32 NO_SHADOW_RESOURCE = ~0U;
+        constexpr u32 NO_SUBGRAPH_INSTANCE = ~0U;
         static BufferLayout AccessToBufferLayout(Access access) {
             bool bTransfer = false;
             bool bCompute = false;
@@ -160,6 +165,106 @@ namespace PyroshockStudios {
             return ImageLayout::Identity;
         }
 
+        static u32 AccelerationStructureId(const TaskAccelerationStructureDependencyInfo& info) {
+            if (eastl::holds_alternative<TaskBlas>(info.accelerationStructure)) {
+                return eastl::get<TaskBlas>(info.accelerationStructure)->GetId();
+            } else if (eastl::holds_alternative<TaskTlas>(info.accelerationStructure)) {
+                return eastl::get<TaskTlas>(info.accelerationStructure)->GetId();
+            }
+            ASSERT(false, "Bad Acceleration Structure Variant!");
+            return ~0U;
+        }
+
+        // A write that does not read the previous contents can start a new version of the resource
+        static bool IsDiscardingWrite(TaskAccessType access) {
+            return (access.type & AccessTypeFlagBits::WRITE) && !(access.type & AccessTypeFlagBits::READ);
+        }
+        static u32 ShadowResourceIndex(const eastl::vector<u32>& shadows, usize dependencyIndex) {
+            return dependencyIndex < shadows.size() ? shadows[dependencyIndex] : NO_SHADOW_RESOURCE;
+        }
+
+        // Drops the barrier of a skipped task and carries its source over to the next barrier of the resource.
+        // Returns true if the barrier was dropped.
+        template <typename Handle, typename Barrier>
+        static bool FoldSkippedBarrier(eastl::hash_map<Handle, Barrier>& carried, Handle handle, Barrier& barrier, bool bSkipped) {
+            if (bSkipped) {
+                // keeps the oldest source if several skipped tasks follow each other
+                carried.emplace(handle, barrier);
+                return true;
+            }
+            auto it = carried.find(handle);
+            if (it != carried.end()) {
+                barrier.srcAccess = it->second.srcAccess;
+                barrier.srcLayout = it->second.srcLayout;
+                carried.erase(it);
+            }
+            return false;
+        }
+
+        bool HasReachability(const eastl::vector<TaskDebugEdges>& edges, const eastl::vector<u64>& reachable) {
+            const usize taskCount = edges.size();
+            const usize wordCount = (taskCount + 63) / 64;
+            eastl::vector<u64> closure(taskCount * wordCount, 0);
+            for (usize child = 0; child < taskCount; ++child) {
+                u64* childReach = &closure[child * wordCount];
+                for (TaskId parent : edges[child].dependencies) {
+                    const u64* parentReach = &closure[parent * wordCount];
+                    for (usize word = 0; word < wordCount; ++word) {
+                        childReach[word] |= parentReach[word];
+                    }
+                    childReach[parent / 64] |= 1ull << (parent % 64);
+                }
+            }
+            return closure == reachable;
+        }
+
+        // Drops every edge that is already implied by a longer path (A->B->C makes A->C redundant).
+        // Tasks only ever depend on previously added tasks, so walking the ids in ascending order
+        // is a valid topological order and a single pass is enough.
+        void ReduceTransitiveEdges(eastl::vector<TaskDebugEdges>& edges) {
+            const usize taskCount = edges.size();
+            const usize wordCount = (taskCount + 63) / 64;
+
+            // reachable[task] is a bitset of every task that task transitively depends on
+            eastl::vector<u64> reachable(taskCount * wordCount, 0);
+            eastl::vector<u64> covered(wordCount, 0);
+
+            for (usize child = 0; child < taskCount; ++child) {
+                auto& parents = edges[child].dependencies;
+                // visit the closest parents first, anything they already reach is redundant
+                eastl::sort(parents.begin(), parents.end(), eastl::greater<TaskId>());
+                eastl::fill(covered.begin(), covered.end(), 0ull);
+
+                auto kept = parents.begin();
+                for (TaskId parent : parents) {
+                    ASSERT(parent < child, "Task depends on itself or on a task added after it!");
+                    const u64 parentBit = 1ull << (parent % 64);
+                    if (covered[parent / 64] & parentBit) {
+                        continue;
+                    }
+                    *kept++ = parent;
+                    const u64* parentReach = &reachable[parent * wordCount];
+                    for (usize word = 0; word < wordCount; ++word) {
+                        covered[word] |= parentReach[word];
+                    }
+                    covered[parent / 64] |= parentBit;
+                }
+                parents.erase(kept, parents.end());
+                eastl::sort(parents.begin(), parents.end());
+                eastl::copy(covered.begin(), covered.end(), reachable.begin() + child * wordCount);
+            }
+
+            for (auto& edge : edges) {
+                edge.dependents.clear();
+            }
+            for (usize child = 0; child < taskCount; ++child) {
+                for (TaskId parent : edges[child].dependencies) {
+                    edges[parent].dependents.push_back(static_cast<TaskId>(child));
+                }
+            }
+            DEBUG_ASSERT(HasReachability(edges, reachable), "Transitive reduction changed which tasks depend on each other!");
+        }
+
 
         class TaskExecute : DeleteCopy, DeleteMove {
         public:
@@ -190,10 +295,20 @@ namespace PyroshockStudios {
             PYRO_NODISCARD PYRO_FORCEINLINE GenericTask* GetTask() {
                 return mTask;
             }
+            // render targets of the task, nullptr for anything recorded outside of a render pass
+            PYRO_NODISCARD virtual GraphicsTask* GetGraphicsTask() {
+                return nullptr;
+            }
 
             ITimestampQueryPool* mTimestampPool = nullptr;
             u32 mBaseTimestampIndex = 0;
 
+            // shadow resource used by every buffer/image dependency, NO_SHADOW_RESOURCE for the original allocation
+            eastl::vector<u32> mBufferShadows = {};
+            eastl::vector<u32> mImageShadows = {};
+            // one entry per renamed resource, resolved by the command list while the task records
+            eastl::vector<TaskShadowBinding> mShadowBindings = {};
+
         private:
             GenericTask* mTask = {};
         };
@@ -201,7 +316,7 @@ namespace PyroshockStudios {
         class GraphicsTaskExecute : public TaskExecute {
         public:
             GraphicsTaskExecute(GraphicsTask* task, RenderPassBeginInfo&& renderPassBeginInfo, SwapChainRtTable&& rtTable)
-                : TaskExecute(task), mRenderPassInfo(eastl::move(renderPassBeginInfo)), mSwapChainRtLut(eastl::move(rtTable)) {
+                : TaskExecute(task), mGraphicsTask(task), mRenderPassInfo(eastl::move(renderPassBeginInfo)), mSwapChainRtLut(eastl::move(rtTable)) {
             }
             ~GraphicsTaskExecute() = default;
             void PreExec(ICommandBuffer* commandBuffer) override {
@@ -222,7 +337,22 @@ namespace PyroshockStudios {
                 TaskExecute::PostExec(commandBuffer);
             }
 
+            void PatchColorTarget(u32 index, bool bResolve, RenderTarget target) {
+                if (bResolve) {
+                    mRenderPassInfo.colorAttachments[index].resolve.value().target = target;
+                } else {
+                    mRenderPassInfo.colorAttachments[index].target = target;
+                }
+            }
+            void PatchDepthStencilTarget(RenderTarget target) {
+                mRenderPassInfo.depthStencilAttachment.value().target = target;
+            }
+            PYRO_NODISCARD GraphicsTask* GetGraphicsTask() override {
+                return mGraphicsTask;
+            }
+
         private:
+            GraphicsTask* mGraphicsTask = nullptr;
             SwapChainRtTable mSwapChainRtLut;
             RenderPassBeginInfo mRenderPassInfo = {};
         };
@@ -237,21 +367,50 @@ namespace PyroshockStudios {
             ~TransferTaskExecute() = default;
         };
 
+        static DefaultTaskScheduler gDefaultTaskScheduler = {};
+
         TaskGraph::TaskGraph(const TaskGraphInfo& info)
             : mDevice(info.resourceManager->mDevice), mQueue(mDevice->GetPresentQueue()), mResourceManager(info.resourceManager),
-              mFramesInFlight(info.resourceManager->mFramesInFlight) {
+              mScheduler(info.scheduler), mFramesInFlight(info.resourceManager->mFramesInFlight), mSubmitChunkCount(info.submitChunkCount),
+              bResourceVersioning(info.bResourceVersioning), mScheduleCachePath(info.scheduleCachePath),
+              bLateSwapChainAcquire(info.bLateSwapChainAcquire), bLowLatencyPacing(info.bLowLatencyPacing),
+              mTransientUniforms(mDevice, mFramesInFlight) {
+            ASSERT(mSubmitChunkCount > 0, "A task graph needs at least one submit chunk!");
+            mVariants.push_back({ .bAllTasks = true });
+            mResourceManager->mTaskGraphs.EmplaceBack(this);
 
             mGpuFrameTimeline = mDevice->CreateFence({ .name = "Task Graph GPU Timeline" });
+            mSubmitTimeline = mDevice->CreateFence({ .name = "Task Graph Submit Timeline" });
         }
         TaskGraph::~TaskGraph() {
+            mResourceManager->mTaskGraphs.EraseFirstItem(this);
+            if (mPendingBuild.valid()) {
+                mPendingBuild.wait();
+            }
+            {
+                std::lock_guard l(mFrameSlotLock);
+                mbStopFrameSlotWaiter = true;
+            }
+            mFrameSlotSignal.notify_all();
+            if (mFrameSlotWaiter.joinable()) {
+                mFrameSlotWaiter.join();
+            }
+            mPendingGraph = nullptr;
             mDevice->WaitIdle();
+            mResourceManager->ReleaseGraphFences(this);
             // cleanup resources
             this->Reset();
+            ReleaseReadbackPages();
             mDevice->Destroy(mGpuFrameTimeline);
+            mDevice->Destroy(mSubmitTimeline);
         }
 
         void TaskGraph::AddTask(GraphicsTask* task) {
             ASSERT(task);
+            if (bRecordingRebuild) {
+                mPendingGraph->AddTask(task);
+                return;
+            }
             ASSERT(!bBaked, "Cannot add to a task graph after it was built!");
             task->SetupTask();
             SwapChainRtTable swapChainRtLookup{};
@@ -336,6 +495,10 @@ namespace PyroshockStudios {
         }
         void TaskGraph::AddTask(ComputeTask* task) {
             ASSERT(task);
+            if (bRecordingRebuild) {
+                mPendingGraph->AddTask(task);
+                return;
+            }
             ASSERT(!bBaked, "Cannot add to a task graph after it was built!");
             task->SetupTask();
             mAllTaskRefs.push_back(task);
@@ -343,6 +506,10 @@ namespace PyroshockStudios {
         }
         void TaskGraph::AddTask(TransferTask* task) {
             ASSERT(task);
+            if (bRecordingRebuild) {
+                mPendingGraph->AddTask(task);
+                return;
+            }
             ASSERT(!bBaked, "Cannot add to a task graph after it was built!");
             task->SetupTask();
             mAllTaskRefs.push_back(task);
@@ -350,6 +517,10 @@ namespace PyroshockStudios {
         }
         void TaskGraph::AddTask(CustomTask* task) {
             ASSERT(task);
+            if (bRecordingRebuild) {
+                mPendingGraph->AddTask(task);
+                return;
+            }
             ASSERT(!bBaked, "Cannot add to a task graph after it was built!");
             task->SetupTask();
             mAllTaskRefs.push_back(task);
@@ -357,6 +528,14 @@ namespace PyroshockStudios {
         }
 
         void TaskGraph::Reset() {
+            if (mPendingBuild.valid()) {
+                mPendingBuild.wait();
+                mPendingBuild = {};
+            }
+            if (mPendingGraph) {
+                mPendingGraph->Reset();
+            }
+            bRecordingRebuild = false;
             for (TaskExecute* task : mTasks) {
                 delete task;
             }
@@ -366,15 +545,55 @@ namespace PyroshockStudios {
                 }
                 mTimestampQueryPools.clear();
             }
+            for (TaskShadowResource& shadow : mShadowResources) {
+                if (shadow.srv != PYRO_NULL_SRV) {
+                    mDevice->DestroyDeferred(shadow.srv);
+                }
+                if (shadow.uav != PYRO_NULL_UAV) {
+                    mDevice->DestroyDeferred(shadow.uav);
+                }
+                if (shadow.buffer) {
+                    mDevice->DestroyDeferred(shadow.buffer);
+                }
+                if (shadow.image) {
+                    mDevice->DestroyDeferred(shadow.image);
+                }
+            }
+            for (RenderTarget renderTarget : mShadowRenderTargets) {
+                mDevice->DestroyDeferred(renderTarget);
+            }
+            mShadowResources.clear();
+            mShadowRenderTargets.clear();
+            for (TaskBuffer& buffer : mVersionedBuffers) {
+                --buffer->mVersioningGraphs;
+            }
+            for (TaskImage& image : mVersionedImages) {
+                --image->mVersioningGraphs;
+            }
+            mVersionedBuffers.clear();
+            mVersionedImages.clear();
             mSwapChains.clear();
             mInternalTasks.clear();
             mTasks.clear();
             mBatches.clear();
             mAllTaskRefs.clear();
             mTaskEdges.clear();
+            mChunkEndBatches.clear();
+            mEnabledTasks.clear();
+            mVariants.clear();
+            mVariants.push_back({ .bAllTasks = true });
+            mActiveVariant = 0;
+            mRequestedVariant = 0;
+            mSubgraphInstances.clear();
+            mTaskSubgraphInstances.clear();
+            mRecordingSubgraph = nullptr;
+            mHandOffs.clear();
+            mImportedAccesses.clear();
             bBaked = false;
         }
         void TaskGraph::Build() {
+            ASSERT(!mRecordingSubgraph, "EndSubgraph() must be called before Build()!");
+            const TaskId userTaskCount = static_cast<TaskId>(mTasks.size());
             {
                 Logger::Trace(mLogStream, "Adding swap chain tasks");
                 eastl::hash_set<TaskSwapChain_*> accessedSwapChains{};
@@ -410,30 +629,283 @@ namespace PyroshockStudios {
                 }
             }
 
+            mImportedAccesses.clear();
+            for (const HandOff& handOff : mHandOffs) {
+                ASSERT(handOff.producer->bBaked, "The producer of a hand off must be built before its consumers!");
+                for (const TaskBuffer& buffer : handOff.buffers) {
+                    mImportedAccesses.push_back({ .producer = handOff.producer, .buffer = buffer, .access = handOff.producer->GetFinalAccess(buffer->GetId(), false) });
+                }
+                for (const TaskImage& image : handOff.images) {
+                    mImportedAccesses.push_back({ .producer = handOff.producer, .image = image, .access = handOff.producer->GetFinalAccess(image->GetId(), false) });
+                }
+            }
+
             Logger::Trace(mLogStream, "Rebuilding tasks");
+            ASSERT(!bResourceVersioning || mVariants.size() == 1, "Resource versioning cannot be combined with task graph variants!");
+            // the tasks of every variant are known before a cached schedule is validated against them
+            for (TaskVariant& variant : mVariants) {
+                variant.enabledTasks.clear();
+                if (!variant.bAllTasks) {
+                    // swap chain tasks were added last and are part of every variant
+                    variant.enabledTasks.resize(mTasks.size(), true);
+                    for (TaskId taskIndex = 0; taskIndex < userTaskCount; ++taskIndex) {
+                        GenericTask* task = mTasks[taskIndex]->GetTask();
+                        variant.enabledTasks[taskIndex] = eastl::find(variant.tasks.begin(), variant.tasks.end(), task) != variant.tasks.end();
+                    }
+                }
+            }
+            // shadow resources are created while versioning, so those graphs always bake from scratch
+            const bool bUseCache = !mScheduleCachePath.empty() && !bResourceVersioning;
+            const u64 setupHash = bUseCache ? ComputeSetupHash() : 0;
+            const bool bCached = bUseCache && LoadScheduleCache(setupHash);
+            if (bCached) {
+                Logger::Trace(mLogStream, "Loaded schedules from cache '{}'", mScheduleCachePath);
+            } else {
+                // a rejected cache may have been read in part
+                for (TaskVariant& variant : mVariants) {
+                    variant.batches.clear();
+                    variant.edges.clear();
+                    variant.chunkEndBatches.clear();
+                }
+            }
+            if (!bCached) {
+                AnalyseSubgraphs();
+            }
+            for (u32 variantIndex = 0; variantIndex < mVariants.size(); ++variantIndex) {
+                TaskVariant& variant = mVariants[variantIndex];
+                if (bCached) {
+                    SwapVariant(variant);
+                } else {
+                    mEnabledTasks = variant.enabledTasks;
+                }
+                if (bCached) {
+                    BuildBarriers();
+                    // hand offs are not part of the setup hash, the cached chunks may run into batches waiting on a producer
+                    if (!mImportedAccesses.empty()) {
+                        BuildSubmitChunks();
+                    }
+                } else {
+                    BakeVariant();
+                }
+                Logger::Trace(mLogStream, "Baked variant #{}, {} batch objects", variantIndex, mBatches.size());
+                SwapVariant(variant);
+            }
+            if (bUseCache && !bCached) {
+                SaveScheduleCache(setupHash);
+            }
+            mActiveVariant = mRequestedVariant < mVariants.size() ? mRequestedVariant : 0;
+            mRequestedVariant = mActiveVariant;
+            SwapVariant(mVariants[mActiveVariant]);
 
-            struct ResourceState {
-                TaskAccessType currentAccess = {};
-                eastl::optional<TaskId> lastTaskId = {};
+            Logger::Trace(mLogStream, "Injecting timestamp profilers");
+            CreateTimestampPools();
+            mBaseGraphTimestampIndex = static_cast<u32>(mTasks.size() * 2);
+            mBaseMiscFlushesTimestampIndex = static_cast<u32>(mTasks.size() * 2 + 2);
+            for (usize i = 0; i < mTasks.size(); ++i) {
+                mTasks[i]->mBaseTimestampIndex = static_cast<u32>(2 * i);
+            }
+            bBaked = true;
+            Logger::Trace(mLogStream, "Rebuilt task graph, {} task objects, {} batch objects", mTasks.size(), mBatches.size());
+        }
+        void TaskGraph::CreateTimestampPools() {
+            for (u32 i = 0; i < mFramesInFlight; ++i) {
+                mTimestampQueryPools.push_back(mDevice->CreateTimestampQueryPool({
+                    .queryCount = static_cast<u32>(mTasks.size() * 2 + 4),
+                    .name = "Timestamp query pool FiF=" + eastl::to_string(i),
+                }));
+            }
+        }
+        void TaskGraph::WaitForPendingBuild() {
+            if (mPendingBuild.valid()) {
+                mPendingBuild.wait();
+            }
+        }
+        void TaskGraph::ResizeFramesInFlight(u32 framesInFlight) {
+            ASSERT(!bInFrame, "Cannot change the frames in flight inside of a frame!");
+            mFramesInFlight = framesInFlight;
+            mFrameIndex = 0;
+            // the resource manager waited for the device, no frame reads the transient uniforms anymore
+            mTransientUniforms.Resize(framesInFlight);
+            if (!bBaked) {
+                return;
+            }
+            for (ITimestampQueryPool* pool : mTimestampQueryPools) {
+                mDevice->DestroyDeferred(pool);
+            }
+            mTimestampQueryPools.clear();
+            CreateTimestampPools();
+
+            // barriers reference the in-flight copies of HostDynamic and Readback buffers, the schedule itself is kept
+            auto rebuildBarriers = [this] {
+                for (Batch& batch : mBatches) {
+                    batch.barriers = {};
+                }
+                BuildBarriers();
             };
+            rebuildBarriers();
+            for (TaskVariantId variant = 0; variant < mVariants.size(); ++variant) {
+                if (variant == mActiveVariant) {
+                    continue;
+                }
+                SwapVariant(mVariants[variant]);
+                rebuildBarriers();
+                SwapVariant(mVariants[variant]);
+            }
+        }
+        void TaskGraph::AnalyseSubgraphs() {
+            mTaskSubgraphInstances.clear();
+            // versioning renames resources per use, so copies are resolved like any other task
+            if (mSubgraphInstances.empty() || bResourceVersioning) {
+                return;
+            }
+            mTaskSubgraphInstances.resize(mTasks.size(), NO_SUBGRAPH_INSTANCE);
+            for (SubgraphInstance& instance : mSubgraphInstances) {
+                instance.subgraph->mbAnalysed = false;
+            }
 
-            struct TaskState {
-                eastl::vector<TaskId> parents = {};
+            eastl::hash_map<u32, u32> slots = {};
+            for (u32 instanceIndex = 0; instanceIndex < mSubgraphInstances.size(); ++instanceIndex) {
+                const SubgraphInstance& instance = mSubgraphInstances[instanceIndex];
+                TaskSubgraph& subgraph = *instance.subgraph;
+                TaskSubgraph::Template& tmpl = subgraph.mTemplate;
+                if (!subgraph.mbAnalysed) {
+                    // the first copy is the only one whose tasks are walked, slots are the bindings followed by shared resources in order of first use
+                    tmpl = { .taskCount = instance.taskCount, .bindingCount = static_cast<u32>(instance.bindings.size()) };
+                    slots.clear();
+                    for (u32 binding = 0; binding < instance.bindings.size(); ++binding) {
+                        const bool bInserted = slots.insert(eastl::make_pair(instance.bindings[binding], binding)).second;
+                        ASSERT(bInserted, "A resource is bound twice in one copy of a subgraph!");
+                    }
+                    auto slotOf = [&](u32 resourceId) {
+                        auto [it, bInserted] = slots.insert(eastl::make_pair(resourceId, static_cast<u32>(slots.size())));
+                        if (bInserted) {
+                            tmpl.sharedResources.push_back(resourceId);
+                        }
+                        return it->second;
+                    };
+                    for (u32 localIndex = 0; localIndex < instance.taskCount; ++localIndex) {
+                        const GenericTask* task = mAllTaskRefs[instance.firstTask + localIndex];
+                        for (const auto& bufferDep : task->mSetupData.bufferDepends) {
+                            tmpl.dependencySlots.push_back(slotOf(bufferDep.buffer->GetId()));
+                        }
+                        for (const auto& imageDep : task->mSetupData.imageDepends) {
+                            tmpl.dependencySlots.push_back(slotOf(imageDep.image->GetId()));
+                        }
+                        for (const auto& asDep : task->mSetupData.accelerationStructureDepends) {
+                            tmpl.dependencySlots.push_back(slotOf(AccelerationStructureId(asDep)));
+                        }
+                    }
+
+                    // same rules as the graph, every use of a resource depends on the previous use
+                    eastl::vector<TaskDebugEdges> localEdges(instance.taskCount);
+                    tmpl.slotUsers.resize(slots.size(), eastl::make_pair(NO_SUBGRAPH_INSTANCE, NO_SUBGRAPH_INSTANCE));
+                    usize cursor = 0;
+                    for (u32 localIndex = 0; localIndex < instance.taskCount; ++localIndex) {
+                        const GenericTask* task = mAllTaskRefs[instance.firstTask + localIndex];
+                        const usize dependencyCount = task->mSetupData.bufferDepends.size() + task->mSetupData.imageDepends.size() +
+                                                      task->mSetupData.accelerationStructureDepends.size();
+                        for (usize i = 0; i < dependencyCount; ++i) {
+                            auto& [firstUser, lastUser] = tmpl.slotUsers[tmpl.dependencySlots[cursor++]];
+                            auto& dependencies = localEdges[localIndex].dependencies;
+                            if (lastUser != NO_SUBGRAPH_INSTANCE && lastUser != localIndex &&
+                                eastl::find(dependencies.begin(), dependencies.end(), lastUser) == dependencies.end()) {
+                                dependencies.push_back(lastUser);
+                            }
+                            if (firstUser == NO_SUBGRAPH_INSTANCE) {
+                                firstUser = localIndex;
+                            }
+                            lastUser = localIndex;
+                        }
+                    }
+                    ReduceTransitiveEdges(localEdges);
+                    for (TaskDebugEdges& edges : localEdges) {
+                        tmpl.localDependencies.emplace_back(eastl::move(edges.dependencies));
+                    }
+                    subgraph.mbAnalysed = true;
+                    Logger::Trace(mLogStream, "Analysed subgraph '{}', {} tasks and {} bindings per copy", subgraph.Info().name, tmpl.taskCount, tmpl.bindingCount);
+                }
+                ASSERT(instance.taskCount == tmpl.taskCount && instance.bindings.size() == tmpl.bindingCount,
+                    "Every copy of a subgraph must add the same tasks and bind the same number of resources!");
+                DEBUG_ASSERT(MatchesSubgraphTemplate(instance), "A copy of a subgraph uses its resources differently from the first copy!");
+                for (u32 localIndex = 0; localIndex < instance.taskCount; ++localIndex) {
+                    mTaskSubgraphInstances[instance.firstTask + localIndex] = instanceIndex;
+                }
+            }
+        }
+        u32 TaskGraph::SubgraphSlotResource(const SubgraphInstance& instance, u32 slot) const {
+            const TaskSubgraph::Template& tmpl = instance.subgraph->mTemplate;
+            return slot < tmpl.bindingCount ? instance.bindings[slot] : tmpl.sharedResources[slot - tmpl.bindingCount];
+        }
+        bool TaskGraph::MatchesSubgraphTemplate(const SubgraphInstance& instance) const {
+            const TaskSubgraph::Template& tmpl = instance.subgraph->mTemplate;
+            // a binding aliasing another slot would hide the dependencies between the two
+            eastl::vector<u32> slotResources = {};
+            for (u32 slot = 0; slot < tmpl.slotUsers.size(); ++slot) {
+                slotResources.push_back(SubgraphSlotResource(instance, slot));
+            }
+            eastl::sort(slotResources.begin(), slotResources.end());
+            if (eastl::adjacent_find(slotResources.begin(), slotResources.end()) != slotResources.end()) {
+                return false;
+            }
+            usize cursor = 0;
+            auto matches = [&](u32 resourceId) {
+                return cursor < tmpl.dependencySlots.size() && SubgraphSlotResource(instance, tmpl.dependencySlots[cursor++]) == resourceId;
+            };
+            for (u32 localIndex = 0; localIndex < instance.taskCount; ++localIndex) {
+                const GenericTask* task = mAllTaskRefs[instance.firstTask + localIndex];
+                for (const auto& bufferDep : task->mSetupData.bufferDepends) {
+                    if (!matches(bufferDep.buffer->GetId())) {
+                        return false;
+                    }
+                }
+                for (const auto& imageDep : task->mSetupData.imageDepends) {
+                    if (!matches(imageDep.image->GetId())) {
+                        return false;
+                    }
+                }
+                for (const auto& asDep : task->mSetupData.accelerationStructureDepends) {
+                    if (!matches(AccelerationStructureId(asDep))) {
+                        return false;
+                    }
+                }
+            }
+            return cursor == tmpl.dependencySlots.size();
+        }
+        void TaskGraph::BakeVariant() {
+            struct ResourceState {
+                eastl::optional<TaskId> lastTaskId = {};
+                u32 versionCount = 0;
+                bool bLoadsPreviousFrame = false;
             };
 
             eastl::vector<ResourceState> currentResources = {};
             currentResources.resize(mResourceManager->mResources.Size());
 
-            eastl::vector<TaskState> currentTasks = {};
-            currentTasks.resize(mTasks.size());
+            // version of the resource used by every buffer/image dependency, only tracked when versioning
+            eastl::vector<eastl::vector<u32>> bufferVersions = {};
+            eastl::vector<eastl::vector<u32>> imageVersions = {};
+            if (bResourceVersioning) {
+                bufferVersions.resize(mTasks.size());
+                imageVersions.resize(mTasks.size());
+            }
 
             // Prepare permanent debug edges
             mTaskEdges.clear();
             mTaskEdges.resize(mTasks.size());
 
+            // dependencies inside a subgraph copy come from its subgraph, unless the variant only runs part of the copy
+            eastl::vector<bool> bTemplatedInstances(mSubgraphInstances.size(), false);
+            if (!mTaskSubgraphInstances.empty()) {
+                for (usize instanceIndex = 0; instanceIndex < mSubgraphInstances.size(); ++instanceIndex) {
+                    const SubgraphInstance& instance = mSubgraphInstances[instanceIndex];
+                    bool bAllEnabled = true;
+                    for (u32 localIndex = 0; localIndex < instance.taskCount; ++localIndex) {
+                        bAllEnabled &= IsTaskEnabled(instance.firstTask + localIndex);
+                    }
+                    bTemplatedInstances[instanceIndex] = bAllEnabled;
+                }
+            }
             auto addDependency = [&](TaskId childId, TaskId parentId) {
-                currentTasks[childId].parents.push_back(parentId);
-
                 auto& debugDependencies = mTaskEdges[childId].dependencies;
                 if (eastl::find(debugDependencies.begin(), debugDependencies.end(), parentId) == debugDependencies.end()) {
                     debugDependencies.push_back(parentId);
@@ -441,109 +913,536 @@ namespace PyroshockStudios {
                     mTaskEdges[parentId].dependents.push_back(childId);
                 }
             };
+            // a discarding write does not have to wait on the previous version, it starts a new one instead
+            auto useVersionedResource = [&](TaskId taskIndex, u32 dependencyIndex, bool bNewVersion) -> u32 {
+                ResourceState& depedencyState = currentResources[dependencyIndex];
+                if (bNewVersion && depedencyState.lastTaskId.has_value() && depedencyState.lastTaskId.value() != taskIndex) {
+                    ++depedencyState.versionCount;
+                } else {
+                    if (depedencyState.lastTaskId.has_value()) {
+                        if (depedencyState.lastTaskId.value() != taskIndex) {
+                            addDependency(taskIndex, depedencyState.lastTaskId.value());
+                        }
+                    } else {
+                        depedencyState.versionCount = 1;
+                        depedencyState.bLoadsPreviousFrame = !bNewVersion;
+                    }
+                }
+                depedencyState.lastTaskId = eastl::make_optional(taskIndex);
+                return depedencyState.versionCount - 1;
+            };
+
+            auto isDiscardingImageWrite = [](TaskExecute* task, const TaskImageDependencyInfo& imageDep) {
+                if (!IsDiscardingWrite(imageDep.access)) {
+                    return false;
+                }
+                // colour targets that are not cleared load the previous contents
+                if (GraphicsTask* graphicsTask = task->GetGraphicsTask(); graphicsTask) {
+                    for (const auto& colorTarget : graphicsTask->mGraphicsSetupData.colorTargets) {
+                        if (!colorTarget.clear && colorTarget.target->Image() == imageDep.image) {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            };
 
             // finds which tasks depends on each other
             for (u32 taskIndex = 0; taskIndex < mTasks.size(); taskIndex++) {
                 TaskExecute*& task = mTasks[taskIndex];
+                if (!IsTaskEnabled(taskIndex)) {
+                    continue;
+                }
+                if (const u32 instanceIndex = mTaskSubgraphInstances.empty() ? NO_SUBGRAPH_INSTANCE : mTaskSubgraphInstances[taskIndex];
+                    instanceIndex != NO_SUBGRAPH_INSTANCE && bTemplatedInstances[instanceIndex]) {
+                    // the rest of the graph only sees the first and last use of each resource inside the copy
+                    const SubgraphInstance& instance = mSubgraphInstances[instanceIndex];
+                    if (taskIndex != instance.firstTask) {
+                        continue;
+                    }
+                    const TaskSubgraph::Template& tmpl = instance.subgraph->mTemplate;
+                    for (u32 slot = 0; slot < tmpl.slotUsers.size(); ++slot) {
+                        const auto [firstUser, lastUser] = tmpl.slotUsers[slot];
+                        if (firstUser == NO_SUBGRAPH_INSTANCE) {
+                            // bound but never used by the tasks
+                            continue;
+                        }
+                        const u32 resourceId = SubgraphSlotResource(instance, slot);
+                        useVersionedResource(instance.firstTask + firstUser, resourceId, false);
+                        currentResources[resourceId].lastTaskId = eastl::make_optional(instance.firstTask + lastUser);
+                    }
+                    for (u32 localIndex = 0; localIndex < instance.taskCount; ++localIndex) {
+                        for (TaskId localParent : tmpl.localDependencies[localIndex]) {
+                            addDependency(instance.firstTask + localIndex, instance.firstTask + localParent);
+                        }
+                    }
+                    continue;
+                }
 
                 for (const auto& bufferDep : task->GetTask()->mSetupData.bufferDepends) {
-                    u32 dependencyIndex = bufferDep.buffer->GetId();
-                    ResourceState& depedencyState = currentResources[dependencyIndex];
-                    if (depedencyState.lastTaskId.has_value()) {
-                        addDependency(taskIndex, depedencyState.lastTaskId.value());
+                    const bool bVersioned = bResourceVersioning && bufferDep.buffer->Info().mode == TaskBufferMode::Default && !bufferDep.buffer->IsSuballocated() &&
+                                            !bufferDep.buffer->mbHasExternalViews;
+                    const u32 version = useVersionedResource(taskIndex, bufferDep.buffer->GetId(), bVersioned && IsDiscardingWrite(bufferDep.access));
+                    if (bResourceVersioning) {
+                        bufferVersions[taskIndex].push_back(bVersioned ? version : NO_SHADOW_RESOURCE);
                     }
-                    depedencyState.lastTaskId = eastl::make_optional(taskIndex);
                 }
 
                 for (const auto& imageDep : task->GetTask()->mSetupData.imageDepends) {
-                    u32 dependencyIndex = imageDep.image->GetId();
-                    ResourceState& depedencyState = currentResources[dependencyIndex];
-                    if (depedencyState.lastTaskId.has_value()) {
-                        addDependency(taskIndex, depedencyState.lastTaskId.value());
+                    const bool bVersioned = bResourceVersioning && !imageDep.image->IsSwapChainOwned() && !imageDep.image->mbHasExternalViews;
+                    const u32 version = useVersionedResource(taskIndex, imageDep.image->GetId(), bVersioned && isDiscardingImageWrite(task, imageDep));
+                    if (bResourceVersioning) {
+                        imageVersions[taskIndex].push_back(bVersioned ? version : NO_SHADOW_RESOURCE);
                     }
-                    depedencyState.lastTaskId = eastl::make_optional(taskIndex);
                 }
 
                 for (const auto& asDep : task->GetTask()->mSetupData.accelerationStructureDepends) {
-                    u32 dependencyIndex = {};
-                    if (eastl::holds_alternative<TaskBlas>(asDep.accelerationStructure)) {
-                        TaskBlas blas = eastl::get<TaskBlas>(asDep.accelerationStructure);
-                        dependencyIndex = blas->GetId();
-                    } else if (eastl::holds_alternative<TaskTlas>(asDep.accelerationStructure)) {
-                        TaskTlas tlas = eastl::get<TaskTlas>(asDep.accelerationStructure);
-                        dependencyIndex = tlas->GetId();
-                    } else {
-                        ASSERT(false, "Bad Acceleration Structure Variant!");
-                    }
+                    useVersionedResource(taskIndex, AccelerationStructureId(asDep), false);
+                }
+            }
 
-                    ResourceState& depedencyState = currentResources[dependencyIndex];
-                    if (depedencyState.lastTaskId.has_value()) {
-                        addDependency(taskIndex, depedencyState.lastTaskId.value());
+            if (bResourceVersioning) {
+                Logger::Trace(mLogStream, "Assigning resource versions");
+                eastl::vector<bool> loadsPreviousFrame(currentResources.size(), false);
+                for (usize i = 0; i < currentResources.size(); ++i) {
+                    loadsPreviousFrame[i] = currentResources[i].bLoadsPreviousFrame;
+                }
+                AssignResourceVersions(bufferVersions, imageVersions, loadsPreviousFrame);
+            }
+
+            Logger::Trace(mLogStream, "Reducing transitive task edges");
+            ReduceTransitiveEdges(mTaskEdges);
+
+            ScheduleBatches();
+            BuildBarriers();
+            BuildSubmitChunks();
+        }
+        void TaskGraph::SwapVariant(TaskVariant& variant) {
+            eastl::swap(mEnabledTasks, variant.enabledTasks);
+            eastl::swap(mBatches, variant.batches);
+            eastl::swap(mTaskEdges, variant.edges);
+            eastl::swap(mChunkEndBatches, variant.chunkEndBatches);
+        }
+        void TaskGraph::AssignResourceVersions(const eastl::vector<eastl::vector<u32>>& bufferVersions, const eastl::vector<eastl::vector<u32>>& imageVersions,
+            const eastl::vector<bool>& loadsPreviousFrame) {
+            const usize taskCount = mTasks.size();
+            const usize wordCount = (taskCount + 63) / 64;
+
+            // ancestors[task] is a bitset of every task that task transitively depends on
+            eastl::vector<u64> ancestors(taskCount * wordCount, 0);
+            for (usize child = 0; child < taskCount; ++child) {
+                u64* childAncestors = &ancestors[child * wordCount];
+                for (TaskId parent : mTaskEdges[child].dependencies) {
+                    const u64* parentAncestors = &ancestors[parent * wordCount];
+                    for (usize word = 0; word < wordCount; ++word) {
+                        childAncestors[word] |= parentAncestors[word];
                     }
-                    depedencyState.lastTaskId = eastl::make_optional(taskIndex);
+                    childAncestors[parent / 64] |= 1ull << (parent % 64);
                 }
             }
+            auto isAncestor = [&](TaskId ancestor, TaskId task) -> bool {
+                return (ancestors[task * wordCount + ancestor / 64] >> (ancestor % 64)) & 1ull;
+            };
+
+            struct Version {
+                TaskId firstTaskId = ~0U;
+                TaskId lastTaskId = 0;
+                u32 slot = 0;
+            };
+            struct VersionedResource {
+                TaskBuffer buffer = {};
+                TaskImage image = {};
+                eastl::vector<Version> versions = {};
+                eastl::vector<u32> slotShadows = {};
+            };
+            eastl::hash_map<u32, VersionedResource> resources = {};
 
-            eastl::vector<TaskId> taskQueue = {};
-            taskQueue.resize(currentTasks.size());
-            eastl::iota(taskQueue.begin(), taskQueue.end(), static_cast<TaskId>(0));
+            auto useVersion = [](VersionedResource& resource, u32 version, TaskId taskIndex) {
+                if (resource.versions.size() <= version) {
+                    resource.versions.resize(version + 1);
+                }
+                Version& used = resource.versions[version];
+                used.firstTaskId = eastl::min(used.firstTaskId, taskIndex);
+                used.lastTaskId = taskIndex;
+            };
+            for (TaskId taskIndex = 0; taskIndex < taskCount; ++taskIndex) {
+                GenericTask* task = mTasks[taskIndex]->GetTask();
+                for (usize i = 0; i < bufferVersions[taskIndex].size(); ++i) {
+                    if (bufferVersions[taskIndex][i] == NO_SHADOW_RESOURCE) {
+                        continue;
+                    }
+                    const TaskBuffer& buffer = task->mSetupData.bufferDepends[i].buffer;
+                    VersionedResource& resource = resources[buffer->GetId()];
+                    resource.buffer = buffer;
+                    useVersion(resource, bufferVersions[taskIndex][i], taskIndex);
+                }
+                for (usize i = 0; i < imageVersions[taskIndex].size(); ++i) {
+                    if (imageVersions[taskIndex][i] == NO_SHADOW_RESOURCE) {
+                        continue;
+                    }
+                    const TaskImage& image = task->mSetupData.imageDepends[i].image;
+                    VersionedResource& resource = resources[image->GetId()];
+                    resource.image = image;
+                    useVersion(resource, imageVersions[taskIndex][i], taskIndex);
+                }
+            }
 
-            // does topological sort / batching
-            while (!taskQueue.empty()) {
-                eastl::vector<TaskId> tasksWithoutParents = {};
+            // Versions are packed into as few allocations as possible. A version can reuse an allocation once
+            // every earlier use of that allocation is an ancestor of its first writer, which keeps the reuse race free.
+            for (auto& [resourceId, resource] : resources) {
+                auto& versions = resource.versions;
+                if (versions.size() < 2) {
+                    resource.slotShadows.push_back(NO_SHADOW_RESOURCE);
+                    continue;
+                }
+                // the first version reads what the last version wrote in the previous frame, so both need the original allocation
+                const bool bPinned = loadsPreviousFrame[resourceId];
+                eastl::vector<TaskId> slotLastTaskIds = { versions[0].lastTaskId };
+                for (usize v = 1; v < versions.size(); ++v) {
+                    Version& version = versions[v];
+                    if (bPinned && v + 1 == versions.size()) {
+                        if (!isAncestor(slotLastTaskIds[0], version.firstTaskId)) {
+                            auto& dependencies = mTaskEdges[version.firstTaskId].dependencies;
+                            if (eastl::find(dependencies.begin(), dependencies.end(), slotLastTaskIds[0]) == dependencies.end()) {
+                                dependencies.push_back(slotLastTaskIds[0]);
+                                mTaskEdges[slotLastTaskIds[0]].dependents.push_back(version.firstTaskId);
+                            }
+                        }
+                        version.slot = 0;
+                    } else {
+                        version.slot = static_cast<u32>(slotLastTaskIds.size());
+                        for (u32 slot = bPinned ? 1 : 0; slot < slotLastTaskIds.size(); ++slot) {
+                            if (isAncestor(slotLastTaskIds[slot], version.firstTaskId)) {
+                                version.slot = slot;
+                                break;
+                            }
+                        }
+                        if (version.slot == slotLastTaskIds.size()) {
+                            slotLastTaskIds.push_back(0);
+                        }
+                    }
+                    slotLastTaskIds[version.slot] = version.lastTaskId;
+                }
 
-                for (TaskId taskIndex : taskQueue) {
-                    if (currentTasks[taskIndex].parents.empty()) {
-                        tasksWithoutParents.push_back(taskIndex);
+                // the last version lives in the original allocation so the resource is up to date after the frame
+                const u32 originalSlot = bPinned ? 0 : versions.back().slot;
+                resource.slotShadows.resize(slotLastTaskIds.size(), NO_SHADOW_RESOURCE);
+                for (u32 slot = 0; slot < slotLastTaskIds.size(); ++slot) {
+                    if (slot == originalSlot) {
+                        continue;
+                    }
+                    TaskShadowResource shadow = {};
+                    if (resource.buffer) {
+                        const TaskBufferInfo& info = resource.buffer->Info();
+                        shadow.buffer = mDevice->CreateBuffer({
+                            .size = info.size,
+                            .usage = info.usage,
+                            .initialLayout = BufferLayout::Undefined,
+                            .allocationDomain = MemoryAllocationDomain::DeviceLocal,
+                            .name = info.name + " (Shadow #" + eastl::to_string(slot) + ")",
+                        });
+                    } else {
+                        const TaskImageInfo& info = resource.image->Info();
+                        shadow.image = mDevice->CreateImage({
+                            .flags = info.flags,
+                            .dimensions = info.dimensions,
+                            .format = info.format,
+                            .size = info.size,
+                            .mipLevelCount = info.mipLevelCount,
+                            .arrayLayerCount = info.arrayLayerCount,
+                            .sampleCount = info.sampleCount,
+                            .usage = info.usage,
+                            .name = info.name + " (Shadow #" + eastl::to_string(slot) + ")",
+                        });
+                    }
+                    resource.slotShadows[slot] = static_cast<u32>(mShadowResources.size());
+                    mShadowResources.push_back(shadow);
+                }
+                if (resource.slotShadows.size() > 1) {
+                    if (resource.buffer) {
+                        ++resource.buffer->mVersioningGraphs;
+                        mVersionedBuffers.push_back(resource.buffer);
+                    } else {
+                        ++resource.image->mVersioningGraphs;
+                        mVersionedImages.push_back(resource.image);
                     }
                 }
+            }
 
-                taskQueue.erase(eastl::remove_if(taskQueue.begin(), taskQueue.end(), [&](TaskId x) {
-                    return eastl::find(tasksWithoutParents.begin(), tasksWithoutParents.end(), x) != tasksWithoutParents.end();
-                }),
-                    taskQueue.end());
+            for (TaskId taskIndex = 0; taskIndex < taskCount; ++taskIndex) {
+                TaskExecute* taskExec = mTasks[taskIndex];
+                GenericTask* task = taskExec->GetTask();
+                auto bindShadow = [&](const TaskBuffer_* buffer, const TaskImage_* image, u32 shadowIndex) {
+                    if (shadowIndex == NO_SHADOW_RESOURCE) {
+                        return;
+                    }
+                    for (const auto& binding : taskExec->mShadowBindings) {
+                        if (binding.buffer == buffer && binding.image == image) {
+                            return;
+                        }
+                    }
+                    taskExec->mShadowBindings.push_back({ .buffer = buffer, .image = image, .shadowIndex = shadowIndex });
+                };
 
-                for (TaskId taskIndex : taskQueue) {
-                    TaskState& task = currentTasks[taskIndex];
-                    if (task.parents.empty()) {
+                taskExec->mBufferShadows.assign(bufferVersions[taskIndex].size(), NO_SHADOW_RESOURCE);
+                for (usize i = 0; i < bufferVersions[taskIndex].size(); ++i) {
+                    const u32 version = bufferVersions[taskIndex][i];
+                    if (version == NO_SHADOW_RESOURCE) {
+                        continue;
+                    }
+                    TaskBuffer_* buffer = task->mSetupData.bufferDepends[i].buffer.Get();
+                    const VersionedResource& resource = resources[buffer->GetId()];
+                    taskExec->mBufferShadows[i] = resource.slotShadows[resource.versions[version].slot];
+                    bindShadow(buffer, nullptr, taskExec->mBufferShadows[i]);
+                }
+                taskExec->mImageShadows.assign(imageVersions[taskIndex].size(), NO_SHADOW_RESOURCE);
+                for (usize i = 0; i < imageVersions[taskIndex].size(); ++i) {
+                    const u32 version = imageVersions[taskIndex][i];
+                    if (version == NO_SHADOW_RESOURCE) {
                         continue;
                     }
+                    TaskImage_* image = task->mSetupData.imageDepends[i].image.Get();
+                    const VersionedResource& resource = resources[image->GetId()];
+                    taskExec->mImageShadows[i] = resource.slotShadows[resource.versions[version].slot];
+                    bindShadow(nullptr, image, taskExec->mImageShadows[i]);
+                }
 
-                    for (usize parent : tasksWithoutParents) {
-                        auto it = eastl::remove_if(task.parents.begin(), task.parents.end(), [&](TaskId& a) {
-                            return a == parent;
-                        });
-                        task.parents.erase(it, task.parents.end());
+                // render targets were created from the original image, the render pass needs targets for the shadows
+                GraphicsTask* graphicsTask = taskExec->GetGraphicsTask();
+                if (!graphicsTask || taskExec->mShadowBindings.empty()) {
+                    continue;
+                }
+                auto findImageShadow = [&](const TaskImage& image) -> u32 {
+                    for (const auto& binding : taskExec->mShadowBindings) {
+                        if (binding.image == image.Get()) {
+                            return binding.shadowIndex;
+                        }
+                    }
+                    return NO_SHADOW_RESOURCE;
+                };
+                auto* graphicsExec = static_cast<GraphicsTaskExecute*>(taskExec);
+                const auto& setup = graphicsTask->mGraphicsSetupData;
+                for (u32 i = 0; i < setup.colorTargets.size(); ++i) {
+                    const auto& colorTarget = setup.colorTargets[i];
+                    if (u32 shadowIndex = findImageShadow(colorTarget.target->Image()); shadowIndex != NO_SHADOW_RESOURCE) {
+                        mShadowRenderTargets.push_back(mDevice->CreateRenderTarget({
+                            .image = mShadowResources[shadowIndex].image,
+                            .slice = colorTarget.target->Info().slice,
+                            .flags = RenderTargetFlagBits::COLOR_TARGET,
+                            .name = colorTarget.target->Info().name,
+                        }));
+                        graphicsExec->PatchColorTarget(i, false, mShadowRenderTargets.back());
+                    }
+                    if (!colorTarget.resolve) {
+                        continue;
+                    }
+                    const TaskColorTarget& resolve = colorTarget.resolve.value();
+                    if (u32 shadowIndex = findImageShadow(resolve->Image()); shadowIndex != NO_SHADOW_RESOURCE) {
+                        mShadowRenderTargets.push_back(mDevice->CreateRenderTarget({
+                            .image = mShadowResources[shadowIndex].image,
+                            .slice = resolve->Info().slice,
+                            .flags = RenderTargetFlagBits::COLOR_TARGET,
+                            .name = resolve->Info().name,
+                        }));
+                        graphicsExec->PatchColorTarget(i, true, mShadowRenderTargets.back());
                     }
                 }
+                if (setup.depthStencilTarget) {
+                    const TaskDepthStencilTarget& target = setup.depthStencilTarget->target;
+                    if (u32 shadowIndex = findImageShadow(target->Image()); shadowIndex != NO_SHADOW_RESOURCE) {
+                        mShadowRenderTargets.push_back(mDevice->CreateRenderTarget({
+                            .image = mShadowResources[shadowIndex].image,
+                            .slice = target->Info().slice,
+                            .flags = (target->Info().bDepth ? RenderTargetFlagBits::DEPTH_TARGET : RenderTargetFlags{}) |
+                                     (target->Info().bStencil ? RenderTargetFlagBits::STENCIL_TARGET : RenderTargetFlags{}),
+                            .name = target->Info().name,
+                        }));
+                        graphicsExec->PatchDepthStencilTarget(mShadowRenderTargets.back());
+                    }
+                }
+            }
+            Logger::Trace(mLogStream, "Backed renamed resource versions with {} shadow allocations", mShadowResources.size());
+        }
+        void TaskGraph::SetScheduler(ITaskScheduler* scheduler) {
+            mScheduler = scheduler;
+        }
+        void TaskGraph::Reschedule() {
+            ASSERT(bBaked, "Build() must be called before rescheduling a task graph!");
+            ASSERT(!bInFrame, "Cannot reschedule a task graph in the middle of a frame!");
+            ScheduleBatches();
+            BuildBarriers();
+            BuildSubmitChunks();
+            Logger::Trace(mLogStream, "Rescheduled task graph, {} batch objects", mBatches.size());
+        }
+        eastl::vector<TaskScheduleNode> TaskGraph::BuildScheduleNodes() const {
+            // Every use of a resource depends on the previous use, so the access a task transitions
+            // from is the same in every legal schedule and the barrier count can be taken in id order.
+            const u32 resourceCount = static_cast<u32>(mResourceManager->mResources.Size());
+            eastl::vector<TaskAccessType> lastAccess = {};
+            lastAccess.resize(resourceCount + mShadowResources.size());
+
+            eastl::vector<TaskScheduleNode> nodes = {};
+            nodes.resize(mTasks.size());
+            for (TaskId taskIndex = 0; taskIndex < mTasks.size(); ++taskIndex) {
+                const TaskExecute* taskExec = mTasks[taskIndex];
+                GenericTask* task = mTasks[taskIndex]->GetTask();
+                TaskScheduleNode& node = nodes[taskIndex];
+                node.type = task->GetType();
+                if (!IsTaskEnabled(taskIndex)) {
+                    continue;
+                }
+                node.weightNs = mTimestampQueryPools.empty() ? 0.0 : GetTaskTimingsNs(taskIndex);
+                node.dependencies = mTaskEdges[taskIndex].dependencies;
+                node.dependents = mTaskEdges[taskIndex].dependents;
+
+                auto countBarrier = [&](u32 resourceId, TaskAccessType access) {
+                    if (lastAccess[resourceId] != access) {
+                        lastAccess[resourceId] = access;
+                        ++node.barrierCount;
+                    }
+                };
+                for (usize i = 0; i < task->mSetupData.bufferDepends.size(); ++i) {
+                    const auto& bufferDep = task->mSetupData.bufferDepends[i];
+                    const u32 shadowIndex = ShadowResourceIndex(taskExec->mBufferShadows, i);
+                    countBarrier(shadowIndex == NO_SHADOW_RESOURCE ? bufferDep.buffer->GetId() : resourceCount + shadowIndex, bufferDep.access);
+                }
+                for (usize i = 0; i < task->mSetupData.imageDepends.size(); ++i) {
+                    const auto& imageDep = task->mSetupData.imageDepends[i];
+                    const u32 shadowIndex = ShadowResourceIndex(taskExec->mImageShadows, i);
+                    if (imageDep.reservedBytes & RESERVED_SWAPCHAIN_WRITE_FLAG) {
+                        ++node.barrierCount;
+                    } else {
+                        countBarrier(shadowIndex == NO_SHADOW_RESOURCE ? imageDep.image->GetId() : resourceCount + shadowIndex, imageDep.access);
+                    }
+                }
+                for (const auto& asDep : task->mSetupData.accelerationStructureDepends) {
+                    countBarrier(AccelerationStructureId(asDep), asDep.access);
+                }
+            }
+            return nodes;
+        }
+        void TaskGraph::ScheduleBatches() {
+            Logger::Trace(mLogStream, "Scheduling tasks");
+
+            // as soon as possible batching, every task goes in the batch after its deepest dependency
+            TaskSchedule schedule = {};
+            eastl::vector<u32> asapBatch(mTasks.size(), 0);
+            for (TaskId taskIndex = 0; taskIndex < mTasks.size(); ++taskIndex) {
+                if (!IsTaskEnabled(taskIndex)) {
+                    continue;
+                }
+                u32 batchIndex = 0;
+                for (TaskId parent : mTaskEdges[taskIndex].dependencies) {
+                    batchIndex = eastl::max(batchIndex, asapBatch[parent] + 1);
+                }
+                asapBatch[taskIndex] = batchIndex;
+                if (schedule.size() <= batchIndex) {
+                    schedule.resize(batchIndex + 1);
+                }
+                schedule[batchIndex].push_back(taskIndex);
+            }
 
+            eastl::vector<TaskScheduleNode> nodes = BuildScheduleNodes();
+            ITaskScheduler* scheduler = mScheduler ? mScheduler : &gDefaultTaskScheduler;
+            scheduler->Schedule({ .tasks = nodes }, schedule);
+
+            eastl::vector<u32> scheduledBatch(mTasks.size(), ~0U);
+            for (u32 batchIndex = 0; batchIndex < schedule.size(); ++batchIndex) {
+                for (TaskId taskIndex : schedule[batchIndex]) {
+                    ASSERT(taskIndex < mTasks.size() && scheduledBatch[taskIndex] == ~0U, "Scheduler placed a task twice!");
+                    scheduledBatch[taskIndex] = batchIndex;
+                }
+            }
+            for (TaskId taskIndex = 0; taskIndex < mTasks.size(); ++taskIndex) {
+                if (!IsTaskEnabled(taskIndex)) {
+                    ASSERT(scheduledBatch[taskIndex] == ~0U, "Scheduler placed a disabled task!");
+                    continue;
+                }
+                ASSERT(scheduledBatch[taskIndex] != ~0U, "Scheduler dropped a task!");
+                for (TaskId parent : mTaskEdges[taskIndex].dependencies) {
+                    ASSERT(scheduledBatch[parent] < scheduledBatch[taskIndex], "Scheduler placed a task before its dependency!");
+                }
+            }
+
+            mBatches.clear();
+            mBatches.reserve(schedule.size());
+            for (auto& taskIds : schedule) {
+                if (taskIds.empty()) {
+                    continue;
+                }
                 mBatches.push_back({});
-                auto& batch = mBatches.back();
-                batch.taskIds = eastl::move(tasksWithoutParents);
+                mBatches.back().taskIds = eastl::move(taskIds);
+            }
+        }
+        void TaskGraph::BuildBarriers() {
+            struct ResourceState {
+                TaskAccessType currentAccess = {};
+                // last barrier of the resource, as long as it can still be folded
+                eastl::vector<BarrierOwner>* lastOwners = nullptr;
+                usize lastOwnerIndex = 0;
+            };
+            auto useWithBarrier = [](ResourceState& state, eastl::vector<BarrierOwner>& owners, TaskId taskIndex) {
+                owners.push_back({ .task = taskIndex });
+                state.lastOwners = &owners;
+                state.lastOwnerIndex = owners.size() - 1;
+            };
+            // another task relying on the last barrier means it has to be issued even if its own task is skipped
+            auto useWithoutBarrier = [](ResourceState& state, TaskId taskIndex) {
+                if (state.lastOwners && (*state.lastOwners)[state.lastOwnerIndex].task != taskIndex) {
+                    (*state.lastOwners)[state.lastOwnerIndex].bFoldable = false;
+                    state.lastOwners = nullptr;
+                }
+            };
+
+            // renamed versions are tracked separately, after the original resources
+            const u32 resourceCount = static_cast<u32>(mResourceManager->mResources.Size());
+            eastl::vector<ResourceState> currentResources = {};
+            currentResources.resize(resourceCount + mShadowResources.size());
+            eastl::vector<bool> bImported(resourceCount, false);
+            for (const ImportedAccess& imported : mImportedAccesses) {
+                const u32 resourceId = imported.buffer ? imported.buffer->GetId() : imported.image->GetId();
+                currentResources[resourceId].currentAccess = imported.access;
+                bImported[resourceId] = true;
             }
 
             // trackes the state of resources between batches / adds barriers
             for (Batch& batch : mBatches) {
+                batch.bTouchesSwapChain = false;
+                batch.bTouchesHandOff = false;
                 for (TaskId taskIndex : batch.taskIds) {
                     TaskExecute*& task = mTasks[taskIndex];
+                    if (!mImportedAccesses.empty()) {
+                        const auto& setup = task->GetTask()->mSetupData;
+                        batch.bTouchesHandOff |=
+                            eastl::any_of(setup.bufferDepends.begin(), setup.bufferDepends.end(), [&](const auto& dep) { return bImported[dep.buffer->GetId()]; }) ||
+                            eastl::any_of(setup.imageDepends.begin(), setup.imageDepends.end(), [&](const auto& dep) { return bImported[dep.image->GetId()]; });
+                    }
 
-                    for (const auto& bufferDep : task->GetTask()->mSetupData.bufferDepends) {
-                        u32 dependencyIndex = bufferDep.buffer->GetId();
+                    for (usize i = 0; i < task->GetTask()->mSetupData.bufferDepends.size(); ++i) {
+                        const auto& bufferDep = task->GetTask()->mSetupData.bufferDepends[i];
+                        const u32 shadowIndex = ShadowResourceIndex(task->mBufferShadows, i);
+                        u32 dependencyIndex = shadowIndex == NO_SHADOW_RESOURCE ? bufferDep.buffer->GetId() : resourceCount + shadowIndex;
                         ResourceState& dependencyState = currentResources[dependencyIndex];
                         if (dependencyState.currentAccess != bufferDep.access) {
                             BufferMemoryBarrierInfo barrier{};
-                            barrier.buffer = bufferDep.buffer->Internal();
+                            barrier.buffer = shadowIndex == NO_SHADOW_RESOURCE ? bufferDep.buffer->Internal() : mShadowResources[shadowIndex].buffer;
                             barrier.srcLayout = AccessToBufferLayout(dependencyState.currentAccess);
                             barrier.srcAccess = dependencyState.currentAccess;
                             barrier.dstLayout = AccessToBufferLayout(bufferDep.access);
                             barrier.dstAccess = bufferDep.access;
                             batch.barriers.buffer.push_back(barrier);
+                            useWithBarrier(dependencyState, batch.barriers.bufferOwners, taskIndex);
                             dependencyState.currentAccess = bufferDep.access;
+                        } else {
+                            useWithoutBarrier(dependencyState, taskIndex);
                         }
                     }
-                    for (const auto& imageDep : task->GetTask()->mSetupData.imageDepends) {
-                        u32 dependencyIndex = imageDep.image->GetId();
+                    for (usize i = 0; i < task->GetTask()->mSetupData.imageDepends.size(); ++i) {
+                        const auto& imageDep = task->GetTask()->mSetupData.imageDepends[i];
+                        const u32 shadowIndex = ShadowResourceIndex(task->mImageShadows, i);
+                        u32 dependencyIndex = shadowIndex == NO_SHADOW_RESOURCE ? imageDep.image->GetId() : resourceCount + shadowIndex;
                         ResourceState& dependencyState = currentResources[dependencyIndex];
+                        batch.bTouchesSwapChain |= imageDep.image->IsSwapChainOwned();
                         if (imageDep.reservedBytes & RESERVED_SWAPCHAIN_WRITE_FLAG) {
                             batch.barriers.imageLambda.emplace_back([=] {
                                 ImageMemoryBarrierInfo barrier{};
@@ -554,6 +1453,7 @@ namespace PyroshockStudios {
                                 barrier.dstAccess = AccessConsts::BOTTOM_OF_PIPE_READ;
                                 return barrier;
                             });
+                            useWithBarrier(dependencyState, batch.barriers.imageLambdaOwners, taskIndex);
                         } else {
                             if (dependencyState.currentAccess != imageDep.access) {
                                 if (imageDep.image->IsSwapChainOwned()) {
@@ -567,16 +1467,20 @@ namespace PyroshockStudios {
                                         barrier.image = imageDep.image->Internal();
                                         return barrier;
                                     });
+                                    useWithBarrier(dependencyState, batch.barriers.imageLambdaOwners, taskIndex);
                                 } else {
                                     ImageMemoryBarrierInfo barrier{};
                                     barrier.srcLayout = AccessToImageLayout(dependencyState.currentAccess);
                                     barrier.srcAccess = dependencyState.currentAccess;
                                     barrier.dstLayout = AccessToImageLayout(imageDep.access);
                                     barrier.dstAccess = imageDep.access;
-                                    barrier.image = imageDep.image->Internal();
+                                    barrier.image = shadowIndex == NO_SHADOW_RESOURCE ? imageDep.image->Internal() : mShadowResources[shadowIndex].image;
                                     batch.barriers.image.push_back(barrier);
+                                    useWithBarrier(dependencyState, batch.barriers.imageOwners, taskIndex);
                                 }
                                 dependencyState.currentAccess = imageDep.access;
+                            } else {
+                                useWithoutBarrier(dependencyState, taskIndex);
                             }
                         }
                     }
@@ -606,82 +1510,328 @@ namespace PyroshockStudios {
                     }
                 }
             }
+        }
+        void TaskGraph::BuildSubmitChunks() {
+            mChunkEndBatches.clear();
+            if (mSubmitChunkCount <= 1) {
+                return;
+            }
 
-            TaskType previousTaskType = TaskType::None;
-            for (size_t i = 0; i < mBatches.size(); ++i) {
-                Batch& batch = mBatches[i];
-
-                TaskType nextBatchFirstType = TaskType::None;
-                if (i + 1 < mBatches.size()) {
-                    if (!mBatches[i + 1].taskIds.empty()) {
-                        TaskId firstId = mBatches[i + 1].taskIds.front();
-                        nextBatchFirstType = mTasks[firstId]->GetTask()->GetType();
-                    }
+            // swap chain images and handed off resources may only be touched by the last chunk,
+            // which is the submission waiting on the acquire and on the producers
+            u32 splittableBatchCount = 0;
+            usize splittableTaskCount = 0;
+            for (const Batch& batch : mBatches) {
+                if (batch.bTouchesSwapChain || batch.bTouchesHandOff) {
+                    break;
                 }
+                ++splittableBatchCount;
+                splittableTaskCount += batch.taskIds.size();
+            }
 
-                eastl::sort(batch.taskIds.begin(), batch.taskIds.end(), [this, previousTaskType, nextBatchFirstType](TaskId a, TaskId b) {
-                    GenericTask* taskA = mTasks[a]->GetTask();
-                    GenericTask* taskB = mTasks[b]->GetTask();
-
-                    if (taskA->GetType() == previousTaskType && taskB->GetType() != previousTaskType) {
-                        return true;
-                    }
-
-                    if (taskA->GetType() != previousTaskType && taskB->GetType() == previousTaskType) {
-                        return false;
+            // split the batches before the swap chain into chunks of roughly equal task counts
+            usize scheduledTaskCount = 0;
+            for (const Batch& batch : mBatches) {
+                scheduledTaskCount += batch.taskIds.size();
+            }
+            const usize tasksPerChunk = eastl::max<usize>(1, (scheduledTaskCount + mSubmitChunkCount - 1) / mSubmitChunkCount);
+            usize recordedTasks = 0;
+            for (u32 batchIndex = 0; batchIndex < splittableBatchCount && mChunkEndBatches.size() + 1 < mSubmitChunkCount; ++batchIndex) {
+                recordedTasks += mBatches[batchIndex].taskIds.size();
+                if (recordedTasks >= tasksPerChunk * (mChunkEndBatches.size() + 1) && batchIndex + 1 < mBatches.size()) {
+                    mChunkEndBatches.push_back(batchIndex + 1);
+                }
+            }
+            Logger::Trace(mLogStream, "Split task graph into {} submissions, {} of {} tasks can be submitted early",
+                mChunkEndBatches.size() + 1, splittableTaskCount, scheduledTaskCount);
+        }
+        void TaskGraph::AddHandOff(const TaskHandOffInfo& info) {
+            if (bRecordingRebuild) {
+                mPendingGraph->AddHandOff(info);
+                return;
+            }
+            ASSERT(!bBaked, "Cannot add to a task graph after it was built!");
+            ASSERT(info.producer && info.producer != this, "A hand off needs another graph as its producer!");
+            ASSERT(info.producer->mResourceManager == mResourceManager, "Hand offs only work between graphs of the same resource manager!");
+            HandOff handOff = { .producer = info.producer };
+            handOff.buffers.assign(info.buffers.begin(), info.buffers.end());
+            for (const TaskImage& image : info.images) {
+                ASSERT(!image->IsSwapChainOwned(), "Swap chain images cannot be handed off!");
+                handOff.images.push_back(image);
+            }
+            mHandOffs.emplace_back(eastl::move(handOff));
+        }
+        TaskAccessType TaskGraph::GetFinalAccess(u32 resourceId, bool bExecuted) const {
+            // the batches are the active variant, skipped tasks are only known once the frame executed
+            const bool bSkipAware = bExecuted && mSkippedTasks.size() == mTasks.size();
+            for (auto batch = mBatches.rbegin(); batch != mBatches.rend(); ++batch) {
+                for (auto taskIndex = batch->taskIds.rbegin(); taskIndex != batch->taskIds.rend(); ++taskIndex) {
+                    if (bSkipAware && mSkippedTasks[*taskIndex]) {
+                        continue;
                     }
-
-                    if (nextBatchFirstType != TaskType::None) {
-                        if (taskA->GetType() == nextBatchFirstType && taskB->GetType() != nextBatchFirstType) {
-                            return false;
+                    const auto& setup = mTasks[*taskIndex]->GetTask()->mSetupData;
+                    for (auto bufferDep = setup.bufferDepends.rbegin(); bufferDep != setup.bufferDepends.rend(); ++bufferDep) {
+                        if (bufferDep->buffer->GetId() == resourceId) {
+                            return bufferDep->access;
                         }
-                        if (taskA->GetType() != nextBatchFirstType && taskB->GetType() == nextBatchFirstType) {
-                            return true;
+                    }
+                    for (auto imageDep = setup.imageDepends.rbegin(); imageDep != setup.imageDepends.rend(); ++imageDep) {
+                        if (imageDep->image->GetId() == resourceId) {
+                            return imageDep->access;
                         }
                     }
-
-                    return taskA->GetType() < taskB->GetType();
-                });
-
-                if (!batch.taskIds.empty()) {
-                    previousTaskType = mTasks[batch.taskIds.back()]->GetTask()->GetType();
                 }
             }
-
-            Logger::Trace(mLogStream, "Injecting timestamp profilers");
-            for (u32 i = 0; i < mFramesInFlight; ++i) {
-                mTimestampQueryPools.push_back(mDevice->CreateTimestampQueryPool({
-                    .queryCount = static_cast<u32>(mTasks.size() * 2 + 4),
-                    .name = "Timestamp query pool FiF=" + eastl::to_string(i),
-                }));
+            return {};
+        }
+        void TaskGraph::RecordHandOffBarriers(ICommandBuffer* commandBuffer) {
+            // the barriers were built from the producer's full schedule, a producer that skipped tasks this frame left the resource elsewhere
+            auto& states = mResourceManager->GetResourceStateMap();
+            for (const ImportedAccess& imported : mImportedAccesses) {
+                ASSERT(!imported.producer->bInFrame || !imported.producer->mPendingCommands.empty(), "The producer of a hand off must execute before its consumers!");
+                const u32 resourceId = imported.buffer ? imported.buffer->GetId() : imported.image->GetId();
+                const TaskAccessType executed = imported.producer->GetFinalAccess(resourceId, true);
+                if (executed == imported.access) {
+                    continue;
+                }
+                if (imported.buffer) {
+                    BufferMemoryBarrierInfo barrier{};
+                    barrier.buffer = imported.buffer->Internal();
+                    barrier.srcLayout = AccessToBufferLayout(executed);
+                    barrier.srcAccess = executed;
+                    barrier.dstLayout = AccessToBufferLayout(imported.access);
+                    barrier.dstAccess = imported.access;
+                    if (auto lastKnownLayout = states.mLastKnownBufferLayouts.find(barrier.buffer); lastKnownLayout != states.mLastKnownBufferLayouts.end()) {
+                        barrier.srcLayout = lastKnownLayout->second;
+                    }
+                    states.mLastKnownBufferLayouts[barrier.buffer] = barrier.dstLayout;
+                    commandBuffer->BufferBarrier(barrier);
+                } else {
+                    ImageMemoryBarrierInfo barrier{};
+                    barrier.image = imported.image->Internal();
+                    barrier.srcLayout = AccessToImageLayout(executed);
+                    barrier.srcAccess = executed;
+                    barrier.dstLayout = AccessToImageLayout(imported.access);
+                    barrier.dstAccess = imported.access;
+                    if (auto lastKnownLayout = states.mLastKnownImageLayouts.find(barrier.image); lastKnownLayout != states.mLastKnownImageLayouts.end()) {
+                        barrier.srcLayout = lastKnownLayout->second;
+                    }
+                    states.mLastKnownImageLayouts[barrier.image] = barrier.dstLayout;
+                    commandBuffer->ImageBarrier(barrier);
+                }
             }
-            mBaseGraphTimestampIndex = static_cast<u32>(mTasks.size() * 2);
-            mBaseMiscFlushesTimestampIndex = static_cast<u32>(mTasks.size() * 2 + 2);
-            for (usize i = 0; i < mTasks.size(); ++i) {
-                mTasks[i]->mBaseTimestampIndex = static_cast<u32>(2 * i);
+        }
+        void TaskGraph::BeginSubgraph(TaskSubgraph& subgraph, eastl::span<TaskResource_* const> bindings) {
+            if (bRecordingRebuild) {
+                mPendingGraph->BeginSubgraph(subgraph, bindings);
+                return;
             }
-            bBaked = true;
-            Logger::Trace(mLogStream, "Rebuilt task graph, {} task objects, {} batch objects", mTasks.size(), mBatches.size());
+            ASSERT(!bBaked, "Cannot add to a task graph after it was built!");
+            ASSERT(!mRecordingSubgraph, "Subgraphs cannot be nested!");
+            mRecordingSubgraph = &subgraph;
+            mRecordingSubgraphFirstTask = static_cast<TaskId>(mTasks.size());
+            mRecordingSubgraphBindings.clear();
+            for (TaskResource_* binding : bindings) {
+                mRecordingSubgraphBindings.push_back(binding->GetId());
+            }
+        }
+        void TaskGraph::EndSubgraph() {
+            if (bRecordingRebuild) {
+                mPendingGraph->EndSubgraph();
+                return;
+            }
+            ASSERT(mRecordingSubgraph, "BeginSubgraph() must be called before EndSubgraph()!");
+            mSubgraphInstances.push_back({
+                .subgraph = mRecordingSubgraph,
+                .firstTask = mRecordingSubgraphFirstTask,
+                .taskCount = static_cast<u32>(mTasks.size()) - mRecordingSubgraphFirstTask,
+                .bindings = eastl::move(mRecordingSubgraphBindings),
+            });
+            mRecordingSubgraph = nullptr;
+        }
+        TaskVariantId TaskGraph::AddVariant(eastl::span<GenericTask* const> enabledTasks) {
+            if (bRecordingRebuild) {
+                return mPendingGraph->AddVariant(enabledTasks);
+            }
+            ASSERT(!bBaked, "Cannot add a variant to a task graph after it was built!");
+            mVariants.push_back({ .tasks = { enabledTasks.begin(), enabledTasks.end() } });
+            return static_cast<TaskVariantId>(mVariants.size() - 1);
+        }
+        void TaskGraph::SetActiveVariant(TaskVariantId variant) {
+            ASSERT(variant < mVariants.size(), "Variant does not exist!");
+            mRequestedVariant = variant;
+        }
+        TaskVariantId TaskGraph::GetActiveVariant() const {
+            return mActiveVariant;
+        }
+        void TaskGraph::BeginRebuild() {
+            ASSERT(!bRecordingRebuild, "Already recording a rebuild!");
+            ASSERT(!mPendingBuild.valid(), "Previous rebuild has not been installed yet!");
+            if (!mPendingGraph) {
+                mPendingGraph = eastl::make_unique<TaskGraph>(TaskGraphInfo{
+                    .resourceManager = mResourceManager,
+                    .scheduler = mScheduler,
+                    .bResourceVersioning = bResourceVersioning,
+                    .submitChunkCount = mSubmitChunkCount,
+                    .scheduleCachePath = mScheduleCachePath,
+                    .bLateSwapChainAcquire = bLateSwapChainAcquire,
+                    .bLowLatencyPacing = bLowLatencyPacing,
+                });
+            }
+            mPendingGraph->InjectLogger(mLogStream);
+            mPendingGraph->SetScheduler(mScheduler);
+            bRecordingRebuild = true;
+        }
+        void TaskGraph::BuildAsync() {
+            ASSERT(bRecordingRebuild, "BeginRebuild() must be called before BuildAsync()!");
+            bRecordingRebuild = false;
+            TaskGraph* pending = mPendingGraph.get();
+            mPendingBuild = std::async(std::launch::async, [pending] {
+                pending->Build();
+            });
+        }
+        bool TaskGraph::IsRebuildPending() const {
+            return bRecordingRebuild || mPendingBuild.valid();
+        }
+        void TaskGraph::InstallPendingBuild() {
+            if (!mPendingBuild.valid() || mPendingBuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return;
+            }
+            mPendingBuild.get();
+
+            TaskGraph& other = *mPendingGraph;
+            eastl::swap(mInternalTasks, other.mInternalTasks);
+            eastl::swap(mBatches, other.mBatches);
+            eastl::swap(mChunkEndBatches, other.mChunkEndBatches);
+            eastl::swap(mTaskEdges, other.mTaskEdges);
+            eastl::swap(mTasks, other.mTasks);
+            eastl::swap(mSwapChains, other.mSwapChains);
+            eastl::swap(mShadowResources, other.mShadowResources);
+            eastl::swap(mShadowRenderTargets, other.mShadowRenderTargets);
+            eastl::swap(mVersionedBuffers, other.mVersionedBuffers);
+            eastl::swap(mVersionedImages, other.mVersionedImages);
+            eastl::swap(mAllTaskRefs, other.mAllTaskRefs);
+            eastl::swap(mBaseGraphTimestampIndex, other.mBaseGraphTimestampIndex);
+            eastl::swap(mBaseMiscFlushesTimestampIndex, other.mBaseMiscFlushesTimestampIndex);
+            eastl::swap(mTimestampQueryPools, other.mTimestampQueryPools);
+            eastl::swap(mEnabledTasks, other.mEnabledTasks);
+            eastl::swap(mVariants, other.mVariants);
+            eastl::swap(mHandOffs, other.mHandOffs);
+            eastl::swap(mImportedAccesses, other.mImportedAccesses);
+            eastl::swap(mActiveVariant, other.mActiveVariant);
+            mRequestedVariant = mActiveVariant;
+            eastl::swap(bBaked, other.bBaked);
+
+            // the retired graph may still be in flight, Reset() only destroys GPU objects deferred
+            other.Reset();
+            Logger::Trace(mLogStream, "Installed rebuilt task graph, {} task objects, {} batch objects", mTasks.size(), mBatches.size());
         }
         void TaskGraph::BeginFrame(u32 timeoutMilliseconds) {
+            if (!BeginFrameWithin(timeoutMilliseconds)) {
+                Logger::Fatal(mLogStream, "GPU hanging! Aborting program!");
+            }
+        }
+        bool TaskGraph::BeginFrameWithin(u32 timeoutMilliseconds) {
+            InstallPendingBuild();
             ASSERT(bBaked, "Build() must be called before starting a frame in a rendergraph!");
+            ASSERT(!bInFrame, "Already inside of a frame!");
+            if (mRequestedVariant != mActiveVariant) {
+                SwapVariant(mVariants[mActiveVariant]);
+                mActiveVariant = mRequestedVariant;
+                SwapVariant(mVariants[mActiveVariant]);
+            }
+
+            // nothing of the frame is started before the slot is free, so a timeout leaves the graph outside of a frame
+            const u64 waitIndex = GetFrameSlotWaitValue();
+            const auto waitStart = std::chrono::steady_clock::now();
+            if (!mGpuFrameTimeline->WaitForValue(waitIndex, 1000ULL * 1000 * timeoutMilliseconds)) {
+                return false;
+            }
             // i dont know why, but cpu timeline index has to be 1 frame ahead than normal...
             ++mCpuTimelineIndex;
+            mBegunCpuTimelineIndex.store(mCpuTimelineIndex, std::memory_order_release);
             bInFrame = true;
+            bSwapChainsAcquired = false;
+            if (!bLateSwapChainAcquire) {
+                AcquireSwapChains();
+            }
+            mFrameStartTime = std::chrono::steady_clock::now();
+            // the frame that last recorded into this slot retired with the wait above
+            mTransientUniforms.BeginFrame(mFrameIndex);
+
+            // earlier frames past the waited one are polled in order, the first unfinished one bounds the queue depth
+            u64 firstPendingFrame = waitIndex + 1;
+            while (firstPendingFrame < mCpuTimelineIndex && mGpuFrameTimeline->WaitForValue(firstPendingFrame, 0)) {
+                ++firstPendingFrame;
+            }
+            mCurrentReadbackPage = ~0U;
+            PollReadbacks();
+            mFrameStats = {
+                .frame = mCpuTimelineIndex,
+                .cpuWaitNs = std::chrono::duration<f64, std::nano>(mFrameStartTime - waitStart).count(),
+                .gpuQueueDepth = static_cast<u32>(mCpuTimelineIndex - firstPendingFrame),
+            };
+            return true;
+        }
+        bool TaskGraph::TryBeginFrame(u32 timeoutMilliseconds) {
+            return BeginFrameWithin(timeoutMilliseconds);
+        }
+        bool TaskGraph::IsFrameSlotFree() const {
+            ASSERT(!bInFrame, "Already inside of a frame!");
+            return mGpuFrameTimeline->WaitForValue(GetFrameSlotWaitValue(), 0);
+        }
+        u64 TaskGraph::GetFrameSlotWaitValue() const {
+            // low latency pacing waits for the previous frame instead of the oldest frame in flight
+            const u32 framesAhead = bLowLatencyPacing ? 1 : mFramesInFlight;
+            const u64 frame = bInFrame ? mCpuTimelineIndex : mCpuTimelineIndex + 1;
+            return static_cast<u64>(eastl::max<i64>(0, static_cast<i64>(frame) - static_cast<i64>(framesAhead)));
+        }
+        void TaskGraph::SetFrameSlotCallback(TaskFrameSlotCallback&& callback) {
+            std::lock_guard l(mFrameSlotLock);
+            mFrameSlotCallback = eastl::move(callback);
+            if (mFrameSlotCallback && !mFrameSlotWaiter.joinable()) {
+                mFrameSlotWaiter = std::thread([this] { RunFrameSlotWaiter(); });
+            }
+        }
+        void TaskGraph::RunFrameSlotWaiter() {
+            std::unique_lock l(mFrameSlotLock);
+            while (true) {
+                mFrameSlotSignal.wait(l, [this] { return mbStopFrameSlotWaiter || !mPendingFrameSlots.empty(); });
+                if (mbStopFrameSlotWaiter) {
+                    return;
+                }
+                const u64 frame = mPendingFrameSlots.front();
+                TaskFrameSlotCallback callback = mFrameSlotCallback;
+                l.unlock();
+                // the frame is only submitted after EndFrame() returns, so the wait wakes up every 100ms to check for shutdown
+                while (!mGpuFrameTimeline->WaitForValue(frame, 1000 * 1000 * 100)) {
+                    if (mbStopFrameSlotWaiter) {
+                        return;
+                    }
+                }
+                if (callback) {
+                    callback(frame);
+                }
+                l.lock();
+                mPendingFrameSlots.pop_front();
+            }
+        }
+        TaskFrameStats TaskGraph::GetFrameStats() const {
+            return mFrameStats;
+        }
+        void TaskGraph::AcquireSwapChains() {
+            if (bSwapChainsAcquired) {
+                return;
+            }
             for (TaskSwapChain& swapChain : mSwapChains) {
                 u32 imageIndex = swapChain->Internal()->AcquireNextImage();
                 swapChain->bSafePresent = imageIndex != PYRO_SWAPCHAIN_ACQUIRE_FAIL;
             }
-
-            u64 waitIndex = static_cast<u64>(
-                std::max<i64>(
-                    0,
-                    static_cast<i64>(mCpuTimelineIndex) - static_cast<i64>(mFramesInFlight)));
-            if (!mGpuFrameTimeline->WaitForValue(waitIndex, 1000 * 1000 * timeoutMilliseconds)) {
-                Logger::Fatal(mLogStream, "GPU hanging! Aborting program!");
-            }
+            bSwapChainsAcquired = true;
         }
         TaskFrameSubmitInfo TaskGraph::EndFrame() {
+            // nothing touched the swap chains this frame, they still have to be acquired to be presented
+            AcquireSwapChains();
             TaskFrameSubmitInfo submitInfo;
             for (TaskSwapChain& swapChain : mSwapChains) {
                 if (swapChain->bSafePresent) {
@@ -690,9 +1840,28 @@ namespace PyroshockStudios {
             }
             submitInfo.queue = mQueue;
             submitInfo.commandBuffers = eastl::move(mPendingCommands);
+            for (auto handOff = mHandOffs.begin(); handOff != mHandOffs.end(); ++handOff) {
+                TaskGraph* producer = handOff->producer;
+                ASSERT(!producer->bInFrame, "The producer of a hand off must end its frame before its consumers!");
+                auto sameProducer = [producer](const HandOff& other) { return other.producer == producer; };
+                if (eastl::none_of(mHandOffs.begin(), handOff, sameProducer)) {
+                    submitInfo.waitFences.push_back({ producer->mSubmitTimeline, producer->mSubmitTimelineIndex });
+                }
+            }
             submitInfo.signalFences.push_back({ mGpuFrameTimeline, mCpuTimelineIndex });
+            submitInfo.signalFences.push_back({ mSubmitTimeline, ++mSubmitTimelineIndex });
+            mEndedCpuTimelineIndex.store(mCpuTimelineIndex, std::memory_order_release);
             mFrameIndex = (mFrameIndex + 1) % mFramesInFlight;
             bInFrame = false;
+            mFrameStats.cpuFrameNs = std::chrono::duration<f64, std::nano>(std::chrono::steady_clock::now() - mFrameStartTime).count();
+
+            if (mFrameSlotCallback) {
+                {
+                    std::lock_guard l(mFrameSlotLock);
+                    mPendingFrameSlots.push_back(mCpuTimelineIndex);
+                }
+                mFrameSlotSignal.notify_one();
+            }
             mPendingCommands.clear();
             // update frames in flight!
             {
@@ -707,6 +1876,22 @@ namespace PyroshockStudios {
         void TaskGraph::Execute() {
             ASSERT(bInFrame, "Do not call Execute() outside of a frame!");
             ASSERT(mPendingCommands.empty(), "Command buffer should be null!");
+
+            // predicates are evaluated once per frame, barriers are only folded if anything is skipped
+            bool bAnySkipped = false;
+            mSkippedTasks.assign(mTasks.size(), false);
+            for (TaskId taskIndex = 0; taskIndex < mTasks.size(); ++taskIndex) {
+                if (IsTaskEnabled(taskIndex) && !mTasks[taskIndex]->GetTask()->EvaluateEnabled()) {
+                    mSkippedTasks[taskIndex] = true;
+                    bAnySkipped = true;
+                }
+            }
+            auto isFolded = [this](const BarrierOwner& owner) {
+                return owner.bFoldable && mSkippedTasks[owner.task];
+            };
+            eastl::hash_map<Buffer, BufferMemoryBarrierInfo> carriedBufferBarriers = {};
+            eastl::hash_map<Image, ImageMemoryBarrierInfo> carriedImageBarriers = {};
+
             ICommandBuffer* commandBuffer = mQueue->GetCommandBuffer({
                 .name = mQueue->Info().name + "'s Task Graph Commands, #" + eastl::to_string(mFrameIndex),
             });
@@ -737,14 +1922,30 @@ namespace PyroshockStudios {
                         .queryIndex = mBaseMiscFlushesTimestampIndex + 1,
                     });
                 } // FLUSHES END
-                TaskCommandList wrapper{ *mDevice, *commandBuffer };
                 u32 batchIndex = 0;
+                u32 chunkIndex = 0;
+                bool bHandOffBarriersRecorded = false;
                 auto& states = mResourceManager->GetResourceStateMap();
                 for (Batch& batch : mBatches) {
+                    if (batch.bTouchesSwapChain) {
+                        // late acquires happen here, after every earlier chunk was recorded and submitted
+                        AcquireSwapChains();
+                    }
+                    TaskCommandList wrapper{ *mDevice, *commandBuffer };
+                    wrapper.mTransientUniforms = &mTransientUniforms;
+                    wrapper.mShadowResources = mShadowResources.data();
                     commandBuffer->BeginLabel({ .labelColor = LabelColor::BLACK,
                         .name = "Sync Barriers Batch #" + eastl::to_string(batchIndex) });
+                    if (batch.bTouchesHandOff && !bHandOffBarriersRecorded) {
+                        RecordHandOffBarriers(commandBuffer);
+                        bHandOffBarriersRecorded = true;
+                    }
 
-                    for (auto barrier : batch.barriers.buffer) {
+                    for (usize i = 0; i < batch.barriers.buffer.size(); ++i) {
+                        auto barrier = batch.barriers.buffer[i];
+                        if (bAnySkipped && FoldSkippedBarrier(carriedBufferBarriers, barrier.buffer, barrier, isFolded(batch.barriers.bufferOwners[i]))) {
+                            continue;
+                        }
                         auto lastKnownLayout = states.mLastKnownBufferLayouts.find(barrier.buffer);
                         if (lastKnownLayout != states.mLastKnownBufferLayouts.end()) {
                             barrier.srcLayout = lastKnownLayout->second;
@@ -754,7 +1955,11 @@ namespace PyroshockStudios {
                         }
                         commandBuffer->BufferBarrier(barrier);
                     }
-                    for (auto barrier : batch.barriers.image) {
+                    for (usize i = 0; i < batch.barriers.image.size(); ++i) {
+                        auto barrier = batch.barriers.image[i];
+                        if (bAnySkipped && FoldSkippedBarrier(carriedImageBarriers, barrier.image, barrier, isFolded(batch.barriers.imageOwners[i]))) {
+                            continue;
+                        }
                         auto lastKnownLayout = states.mLastKnownImageLayouts.find(barrier.image);
                         if (lastKnownLayout != states.mLastKnownImageLayouts.end()) {
                             barrier.srcLayout = lastKnownLayout->second;
@@ -764,8 +1969,11 @@ namespace PyroshockStudios {
                         }
                         commandBuffer->ImageBarrier(barrier);
                     }
-                    for (auto barrierFn : batch.barriers.imageLambda) {
-                        auto barrier = barrierFn();
+                    for (usize i = 0; i < batch.barriers.imageLambda.size(); ++i) {
+                        auto barrier = batch.barriers.imageLambda[i]();
+                        if (bAnySkipped && FoldSkippedBarrier(carriedImageBarriers, barrier.image, barrier, isFolded(batch.barriers.imageLambdaOwners[i]))) {
+                            continue;
+                        }
                         auto lastKnownLayout = states.mLastKnownImageLayouts.find(barrier.image);
                         if (lastKnownLayout != states.mLastKnownImageLayouts.end()) {
                             barrier.srcLayout = lastKnownLayout->second;
@@ -783,19 +1991,41 @@ namespace PyroshockStudios {
                     }
                     commandBuffer->EndLabel();
                     for (TaskId taskIndex : batch.taskIds) {
+                        if (bAnySkipped && mSkippedTasks[taskIndex]) {
+                            continue;
+                        }
                         TaskExecute* task = mTasks[taskIndex];
                         // printf("Rendering: %s\n", task->GetTask()->Info().name.c_str());
 
                         task->mTimestampPool = mTimestampQueryPools[mFrameIndex];
                         wrapper.mCurrBindPoint = task->GetTask()->GetBindPoint();
 
+                        wrapper.mShadowBindings = task->mShadowBindings;
                         task->PreExec(commandBuffer);
                         task->GetTask()->ExecuteTask(wrapper);
                         task->PostExec(commandBuffer);
                     }
                     ++batchIndex;
+
+                    if (chunkIndex < mChunkEndBatches.size() && mChunkEndBatches[chunkIndex] == batchIndex) {
+                        // hand the recorded chunk to the GPU while the rest of the frame is recorded,
+                        // chunks go to the same queue so they execute in order
+                        commandBuffer->Complete();
+                        FenceSubmitInfo chunkSignal = { mSubmitTimeline, ++mSubmitTimelineIndex };
+                        mDevice->SubmitQueue({
+                            .queue = mQueue,
+                            .commands = { &commandBuffer, 1 },
+                            .signalFences = { &chunkSignal, 1 },
+                        });
+                        ++chunkIndex;
+                        commandBuffer = mQueue->GetCommandBuffer({
+                            .name = mQueue->Info().name + "'s Task Graph Commands, #" + eastl::to_string(mFrameIndex) + " Chunk #" + eastl::to_string(chunkIndex),
+                        });
+                    }
                 }
 
+                RecordReadbacks(commandBuffer);
+
                 commandBuffer->WriteTimestamp({
                     .queryPool = mTimestampQueryPools[mFrameIndex],
                     .stage = PipelineStageFlagBits::BOTTOM_OF_PIPE,
@@ -812,18 +2042,22 @@ namespace PyroshockStudios {
         }
 
         f64 TaskGraph::GetTaskTimingsNs(GenericTask* task) const {
-            for (TaskExecute* taskExec : mTasks) {
-                if (taskExec->GetTask() != task)
+            for (TaskId taskIndex = 0; taskIndex < mTasks.size(); ++taskIndex) {
+                if (mTasks[taskIndex]->GetTask() != task)
                     continue;
-                ITimestampQueryPool* pool = mTimestampQueryPools[(mFrameIndex + 1) % mFramesInFlight];
-                eastl::span timestamps = pool->GetTimestamps(taskExec->mBaseTimestampIndex, 2);
-                if (timestamps.empty())
-                    return 0.0;
-                return static_cast<f64>(timestamps[1] - timestamps[0]) * mQueue->GetTimestampTickPeriodNs();
+                return IsTaskEnabled(taskIndex) ? GetTaskTimingsNs(taskIndex) : 0.0;
             }
             return 0.0;
         }
 
+        f64 TaskGraph::GetTaskTimingsNs(TaskId taskIndex) const {
+            ITimestampQueryPool* pool = mTimestampQueryPools[(mFrameIndex + 1) % mFramesInFlight];
+            eastl::span timestamps = pool->GetTimestamps(mTasks[taskIndex]->mBaseTimestampIndex, 2);
+            if (timestamps.empty())
+                return 0.0;
+            return static_cast<f64>(timestamps[1] - timestamps[0]) * mQueue->GetTimestampTickPeriodNs();
+        }
+
         f64 TaskGraph::GetGraphTimingsNs() const {
             ITimestampQueryPool* pool = mTimestampQueryPools[(mFrameIndex + 1) % mFramesInFlight];
             eastl::span timestamps = pool->GetTimestamps(mBaseGraphTimestampIndex, 2);
@@ -846,13 +2080,21 @@ namespace PyroshockStudios {
         IFence* TaskGraph::GetTimelineFence() {
             return mGpuFrameTimeline;
         }
+        u64 TaskGraph::GetSubmitTimelineValue() const {
+            return mSubmitTimelineIndex;
+        }
+        IFence* TaskGraph::GetSubmitTimelineFence() {
+            return mSubmitTimeline;
+        }
 
         void TaskGraph::FlushStagingBuffers(ICommandBuffer* commandBuffer) {
             auto& states = mResourceManager->GetResourceStateMap();
             commandBuffer->BeginLabel({ .labelColor = LabelColor::BLUE,
                 .name = "Flush staging buffers" });
-            while (!mResourceManager->mPendingStagingUploads.Empty()) {
-                auto uploadPair = mResourceManager->mPendingStagingUploads.PopBack();
+            // heaps created since the last flush start out read only, they hold live suballocations from here on
+            mResourceManager->RegisterBufferHeapLayouts();
+            eastl::vector<eastl::pair<Buffer, BufferLayout>> dstBuffers = {};
+            for (auto& uploadPair : mResourceManager->TakeStagingUploads()) {
                 commandBuffer->BufferBarrier({
                     .buffer = uploadPair.srcBuffer,
                     .srcAccess = AccessConsts::HOST_WRITE,
@@ -860,58 +2102,125 @@ namespace PyroshockStudios {
                     .srcLayout = BufferLayout::TransferSrc,
                     .dstLayout = BufferLayout::TransferSrc,
                 });
-                for (auto& stagingUpload : uploadPair.uploads) {
+                // many uploads can target the same buffer heap, every destination buffer is transitioned once around all of its copies
+                dstBuffers.clear();
+                for (const auto& stagingUpload : uploadPair.uploads) {
+                    auto sameBuffer = [&stagingUpload](const eastl::pair<Buffer, BufferLayout>& dstBuffer) { return dstBuffer.first == stagingUpload.dstBuffer; };
+                    if (stagingUpload.dstBuffer && eastl::none_of(dstBuffers.begin(), dstBuffers.end(), sameBuffer)) {
+                        dstBuffers.emplace_back(stagingUpload.dstBuffer, stagingUpload.dstBufferLayout);
+                    }
+                }
+                for (const auto& [dstBuffer, dstLayout] : dstBuffers) {
+                    // buffer heaps hold live suballocations, their contents must survive the transition
+                    auto lastKnownLayout = states.mLastKnownBufferLayouts.find(dstBuffer);
+                    const bool bKnownLayout = lastKnownLayout != states.mLastKnownBufferLayouts.end();
+                    commandBuffer->BufferBarrier({
+                        .buffer = dstBuffer,
+                        .srcAccess = bKnownLayout ? AccessConsts::READ_WRITE : AccessConsts::NONE,
+                        .dstAccess = AccessConsts::TRANSFER_WRITE,
+                        .srcLayout = bKnownLayout ? lastKnownLayout->second : BufferLayout::Undefined,
+                        .dstLayout = BufferLayout::TransferDst,
+                    });
+                }
+                for (usize uploadIndex = 0; uploadIndex < uploadPair.uploads.size(); ++uploadIndex) {
+                    auto& stagingUpload = uploadPair.uploads[uploadIndex];
                     if (stagingUpload.dstBuffer) {
-                        commandBuffer->BufferBarrier({
-                            .buffer = stagingUpload.dstBuffer,
-                            .srcAccess = AccessConsts::NONE,
-                            .dstAccess = AccessConsts::TRANSFER_WRITE,
-                            .srcLayout = BufferLayout::Undefined,
-                            .dstLayout = BufferLayout::TransferDst,
-                        });
                         commandBuffer->CopyBufferToBuffer({
                             .srcBuffer = uploadPair.srcBuffer,
                             .dstBuffer = stagingUpload.dstBuffer,
-                            .size = mDevice->GetBufferInfo(stagingUpload.dstBuffer).size,
-                        });
-                        commandBuffer->BufferBarrier({
-                            .buffer = stagingUpload.dstBuffer,
-                            .srcAccess = AccessConsts::TRANSFER_WRITE,
-                            .dstAccess = AccessConsts::READ_WRITE, // TODO, not very efficient
-                            .srcLayout = BufferLayout::TransferDst,
-                            .dstLayout = stagingUpload.dstBufferLayout,
+                            .srcOffset = stagingUpload.srcOffset,
+                            .dstOffset = stagingUpload.dstBufferOffset,
+                            .size = stagingUpload.dstBufferSize,
                         });
-                        states.mLastKnownBufferLayouts[stagingUpload.dstBuffer] = stagingUpload.dstBufferLayout;
                     }
                     if (stagingUpload.dstImage) {
-                        commandBuffer->ImageBarrier({
-                            .image = stagingUpload.dstImage,
-                            .srcAccess = AccessConsts::NONE,
-                            .dstAccess = AccessConsts::TRANSFER_WRITE,
-                            .srcLayout = ImageLayout::Undefined,
-                            .dstLayout = ImageLayout::TransferDst,
-                        });
-                        // FIXME: multiple slices?
+                        // consecutive regions of the same image share one transition in and out of TransferDst
+                        const bool bFirstRegion = uploadIndex == 0 || uploadPair.uploads[uploadIndex - 1].dstImage != stagingUpload.dstImage;
+                        const bool bLastRegion = uploadIndex + 1 == uploadPair.uploads.size() || uploadPair.uploads[uploadIndex + 1].dstImage != stagingUpload.dstImage;
+                        if (bFirstRegion) {
+                            commandBuffer->ImageBarrier({
+                                .image = stagingUpload.dstImage,
+                                .srcAccess = AccessConsts::NONE,
+                                .dstAccess = AccessConsts::TRANSFER_WRITE,
+                                .srcLayout = ImageLayout::Undefined,
+                                .dstLayout = ImageLayout::TransferDst,
+                            });
+                        }
                         commandBuffer->CopyBufferToImage({ .buffer = uploadPair.srcBuffer,
+                            .bufferOffset = stagingUpload.srcOffset,
                             .image = stagingUpload.dstImage,
                             .imageSlice = stagingUpload.dstImageSlice,
-                            .imageExtent = mDevice->GetImageInfo(stagingUpload.dstImage).size,
+                            .imageExtent = stagingUpload.dstImageExtent,
                             .rowPitch = stagingUpload.rowPitch });
-                        commandBuffer->ImageBarrier({
-                            .image = stagingUpload.dstImage,
-                            .srcAccess = AccessConsts::TRANSFER_WRITE,
-                            .dstAccess = AccessConsts::READ_WRITE, // TODO, not very efficient
-                            .srcLayout = ImageLayout::TransferDst,
-                            .dstLayout = stagingUpload.dstImageLayout,
-                        });
-                        states.mLastKnownImageLayouts[stagingUpload.dstImage] = stagingUpload.dstImageLayout;
+                        if (bLastRegion && stagingUpload.bGenerateMips) {
+                            GenerateUploadedMips(commandBuffer, stagingUpload);
+                        } else if (bLastRegion) {
+                            commandBuffer->ImageBarrier({
+                                .image = stagingUpload.dstImage,
+                                .srcAccess = AccessConsts::TRANSFER_WRITE,
+                                .dstAccess = AccessConsts::READ_WRITE, // TODO, not very efficient
+                                .srcLayout = ImageLayout::TransferDst,
+                                .dstLayout = stagingUpload.dstImageLayout,
+                            });
+                        }
+                        if (bLastRegion) {
+                            states.mLastKnownImageLayouts[stagingUpload.dstImage] = stagingUpload.dstImageLayout;
+                        }
                     }
                 }
-                mDevice->Destroy(uploadPair.srcBuffer, true);
+                for (const auto& [dstBuffer, dstLayout] : dstBuffers) {
+                    commandBuffer->BufferBarrier({
+                        .buffer = dstBuffer,
+                        .srcAccess = AccessConsts::TRANSFER_WRITE,
+                        .dstAccess = AccessConsts::READ_WRITE, // TODO, not very efficient
+                        .srcLayout = BufferLayout::TransferDst,
+                        .dstLayout = dstLayout,
+                    });
+                    states.mLastKnownBufferLayouts[dstBuffer] = dstLayout;
+                }
+                mResourceManager->RetireStagingUpload(uploadPair, this, mCpuTimelineIndex);
             }
 
             commandBuffer->EndLabel();
         }
+        void TaskGraph::GenerateUploadedMips(ICommandBuffer* commandBuffer, const TaskResourceManager::StagingUploadData& stagingUpload) {
+            const auto& imageInfo = mDevice->GetImageInfo(stagingUpload.dstImage);
+            commandBuffer->ImageBarrier({
+                .image = stagingUpload.dstImage,
+                .srcAccess = AccessConsts::TRANSFER_WRITE,
+                .dstAccess = AccessConsts::COMPUTE_SHADER_READ | AccessConsts::COMPUTE_SHADER_WRITE,
+                .srcLayout = ImageLayout::TransferDst,
+                .dstLayout = ImageLayout::UnorderedAccess,
+            });
+            // views only live for this upload, they are destroyed once the frame retires
+            eastl::vector<UnorderedAccessId> mipViews = {};
+            mipViews.reserve(imageInfo.mipLevelCount);
+            for (u32 mip = 0; mip < imageInfo.mipLevelCount; ++mip) {
+                mipViews.push_back(mDevice->CreateUnorderedAccess(ImageResourceInfo{
+                    .image = stagingUpload.dstImage,
+                    .slice = {
+                        .baseMipLevel = mip,
+                        .levelCount = 1,
+                        .layerCount = imageInfo.arrayLayerCount,
+                    },
+                    .viewType = ImageViewType::e2DArray,
+                }));
+            }
+            TaskCommandList commandList(*mDevice, *commandBuffer);
+            commandList.mCurrBindPoint = PipelineBindPoint::Compute;
+            commandList.mTransientUniforms = &mTransientUniforms;
+            RecordMipGeneration(commandList, mResourceManager->mMipGenerationPipeline, stagingUpload.dstImage, imageInfo.size, imageInfo.arrayLayerCount, mipViews);
+            for (UnorderedAccessId view : mipViews) {
+                mDevice->DestroyDeferred(view);
+            }
+            commandBuffer->ImageBarrier({
+                .image = stagingUpload.dstImage,
+                .srcAccess = AccessConsts::COMPUTE_SHADER_WRITE,
+                .dstAccess = AccessConsts::READ_WRITE,
+                .srcLayout = ImageLayout::UnorderedAccess,
+                .dstLayout = stagingUpload.dstImageLayout,
+            });
+        }
         void TaskGraph::FlushDynamicBuffers(ICommandBuffer* commandBuffer) {
             auto& states = mResourceManager->GetResourceStateMap();
             commandBuffer->BeginLabel({ .labelColor = LabelColor::BLUE,
@@ -1084,7 +2393,8 @@ namespace PyroshockStudios {
                         TaskDebugNode taskNode;
                         taskNode.id = id;
                         taskNode.name = rawTask->Info().name;
-                        taskNode.timingNs = GetTaskTimingsNs(rawTask);
+                        taskNode.type = rawTask->GetType();
+                        taskNode.timingNs = GetTaskTimingsNs(id);
 
                         if (id < mTaskEdges.size()) {
                             taskNode.edges.dependencies = mTaskEdges[id].dependencies;
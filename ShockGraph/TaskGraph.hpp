@@ -22,20 +22,77 @@
 
 #pragma once
 
+#include "ITaskScheduler.hpp"
 #include "Task.hpp"
 #include "TaskCommandList.hpp"
+#include "TaskGraphCapture.hpp"
+#include "TaskSubgraph.hpp"
 #include "TaskResourceManager.hpp"
+#include <EASTL/deque.h>
 #include <EASTL/unique_ptr.h>
 #include <EASTL/vector.h>
 #include <PyroCommon/LoggerInterface.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
 
 namespace PyroshockStudios {
     inline namespace ShockGraph {
         using TaskId = u32;
+        using TaskVariantId = u32;
         struct TaskGraphInfo {
             TaskResourceManager* resourceManager = nullptr;
+            /**
+             * @brief Orders tasks into batches. Must outlive the task graph, nullptr uses the DefaultTaskScheduler.
+             */
+            ITaskScheduler* scheduler = nullptr;
+            /**
+             * @brief Gives every write-only access of a buffer or image a new version of the resource. If a write
+             * only has to wait on earlier reads, the new version is backed by a separate allocation so the two can overlap.
+             * The last version of a frame always lives in the original allocation.
+             * Write-only accesses must overwrite the whole resource, declare partial writes as read-write.
+             * Only dedicated Default buffers and non swap chain images without views created through the resource manager are versioned,
+             * and such views cannot be created until the graph is reset. Tasks must take image views from TaskCommandList::ShaderResource()
+             * and TaskCommandList::UnorderedAccess(), they resolve to the version the task records with.
+             */
+            bool bResourceVersioning = false;
+            /**
+             * @brief Number of command buffers a frame is split into, at batch boundaries. Execute() submits every chunk
+             * but the last as soon as it is recorded, so the GPU starts while the rest of the frame is recorded.
+             * The last chunk is returned by EndFrame(). Only the last chunk touches swap chain images.
+             */
+            u32 submitChunkCount = 1;
+            /**
+             * @brief File the baked schedules are cached in, keyed by a hash of every task setup. If the hash matches,
+             * Build() loads the dependencies, batches and submit chunks instead of computing them. Empty disables the cache.
+             * Graphs with resource versioning are never cached.
+             */
+            eastl::string scheduleCachePath = {};
+            /**
+             * @brief Acquires swap chain images right before the first batch that touches them instead of in BeginFrame(),
+             * so every earlier batch is recorded (and with several submit chunks, submitted) before the acquire.
+             */
+            bool bLateSwapChainAcquire = false;
+            /**
+             * @brief BeginFrame() waits for the previous frame to finish on the GPU instead of the oldest frame in flight.
+             * Keeps at most one frame queued ahead of the GPU, trading throughput for input-to-photon latency.
+             */
+            bool bLowLatencyPacing = false;
         };
         class TaskExecute;
+        class TaskGraph;
+
+        struct TaskHandOffInfo {
+            /**
+             * @brief Graph writing the resources. It must be built before the consuming graph.
+             */
+            TaskGraph* producer = nullptr;
+            eastl::span<const TaskBuffer> buffers = {};
+            eastl::span<const TaskImage> images = {};
+        };
 
         struct TaskSwapChainWriteInfo {
             TaskImage image = nullptr;
@@ -46,9 +103,73 @@ namespace PyroshockStudios {
         struct TaskFrameSubmitInfo {
             ICommandQueue* queue;
             eastl::vector<ICommandBuffer*> commandBuffers;
+            /**
+             * @brief Submit timelines of the graphs this frame consumes resources from, see TaskGraph::AddHandOff().
+             */
+            eastl::vector<FenceSubmitInfo> waitFences;
             eastl::vector<FenceSubmitInfo> signalFences;
             eastl::vector<ISwapChain*> presentSwapChains;
         };
+        /**
+         * @brief Frame pacing measurements of a single frame, see TaskGraph::GetFrameStats().
+         */
+        struct TaskFrameStats {
+            /**
+             * @brief CPU timeline value of the frame.
+             */
+            u64 frame = 0;
+            /**
+             * @brief Time BeginFrame() blocked waiting for a free frame slot.
+             */
+            f64 cpuWaitNs = 0.0;
+            /**
+             * @brief Time between the start of the frame and EndFrame(), 0.0 while the frame is recorded.
+             */
+            f64 cpuFrameNs = 0.0;
+            /**
+             * @brief Earlier frames still executing on the GPU when the frame started.
+             */
+            u32 gpuQueueDepth = 0;
+        };
+        /**
+         * @brief Called with the CPU timeline value of a frame once the GPU finished it and its frame slot is free.
+         */
+        using TaskFrameSlotCallback = eastl::function<void(u64 frame)>;
+        struct TaskReadbackResult {
+            /**
+             * @brief CPU timeline value of the frame the data was copied in.
+             */
+            u64 frame = 0;
+            /**
+             * @brief Copied bytes, only valid during the callback.
+             */
+            eastl::span<const u8> data = {};
+        };
+        using TaskReadbackCallback = eastl::function<void(const TaskReadbackResult& result)>;
+        struct TaskBufferReadbackInfo {
+            TaskBuffer buffer = {};
+            /**
+             * @brief A size of 0 reads until the end of the buffer.
+             */
+            BufferRegion region = {};
+            TaskReadbackCallback callback = {};
+        };
+        struct TaskImageReadbackInfo {
+            TaskImage image = {};
+            /**
+             * @brief A single mip level and array layer.
+             */
+            ImageArraySlice slice = {};
+            /**
+             * @brief An empty extent reads the whole image.
+             */
+            Extent3D extent = {};
+            /**
+             * @brief Bytes per row of the copied data, as with staging uploads.
+             */
+            u32 rowPitch = 0;
+            TaskReadbackCallback callback = {};
+        };
         struct TaskDebugBufferBarrier {
             eastl::string name;
             u64 handle;
@@ -73,14 +194,26 @@ namespace PyroshockStudios {
             u64 handle;
             eastl::string type; // "BLAS" or "TLAS"
         };
+        // Edges are transitively reduced: an edge implied by a longer path (A->B->C makes A->C) is not listed.
         struct TaskDebugEdges {
             eastl::vector<TaskId> dependencies; // Parents (Tasks this task waits on)
             eastl::vector<TaskId> dependents;   // Children (Tasks waiting on this task)
         };
+        /**
+         * @brief Drops every dependency that is implied by a longer path and rebuilds the dependents from the dependencies.
+         * Tasks may only depend on tasks with a lower id.
+         */
+        SHOCKGRAPH_API void ReduceTransitiveEdges(eastl::vector<TaskDebugEdges>& edges);
+        /**
+         * @brief Checks that the transitive closure of the dependencies matches reachable, a row of (edges.size() + 63) / 64 words
+         * per task with a bit set for every task it transitively depends on.
+         */
+        PYRO_NODISCARD SHOCKGRAPH_API bool HasReachability(const eastl::vector<TaskDebugEdges>& edges, const eastl::vector<u64>& reachable);
 
         struct TaskDebugNode {
             TaskId id;
             eastl::string name;
+            TaskType type = TaskType::None;
             f64 timingNs = 0.0;
 
             TaskDebugEdges edges;
@@ -113,7 +246,94 @@ namespace PyroshockStudios {
             SHOCKGRAPH_API void Reset();
             SHOCKGRAPH_API void Build();
 
+            /**
+             * @brief Registers a variant that only runs the given tasks, must be called before Build().
+             * Build() bakes a separate schedule for every variant, sharing the resources and pipelines of the graph.
+             * Variant 0 always runs every task. Cannot be combined with resource versioning.
+             */
+            PYRO_NODISCARD SHOCKGRAPH_API TaskVariantId AddVariant(eastl::span<GenericTask* const> enabledTasks);
+            /**
+             * @brief Switches to a baked variant at the next BeginFrame(), without rebuilding.
+             */
+            SHOCKGRAPH_API void SetActiveVariant(TaskVariantId variant);
+            PYRO_NODISCARD SHOCKGRAPH_API TaskVariantId GetActiveVariant() const;
+
+            /**
+             * @brief Records every task added until EndSubgraph() as one copy of the subgraph.
+             * @param bindings Resources that differ between copies, in the same order for every copy. Resources the tasks use
+             * that are not bound must be the same for every copy.
+             */
+            SHOCKGRAPH_API void BeginSubgraph(TaskSubgraph& subgraph, eastl::span<TaskResource_* const> bindings);
+            SHOCKGRAPH_API void EndSubgraph();
+
+            /**
+             * @brief Consumes resources written by another graph of the same resource manager. The first barrier of every
+             * handed off resource transitions from the last access the producer executed, and the frame waits on the producer's
+             * submit timeline through TaskFrameSubmitInfo::waitFences instead of a device wide wait. Batches using handed off
+             * resources are never submitted early, see TaskGraphInfo::submitChunkCount.
+             * The producer must execute before this graph does, and end its frame before this graph does.
+             */
+            SHOCKGRAPH_API void AddHandOff(const TaskHandOffInfo& info);
+
+            /**
+             * @brief Starts recording a new set of tasks while the baked graph keeps executing.
+             * Every AddTask() until BuildAsync() goes to the new graph.
+             */
+            SHOCKGRAPH_API void BeginRebuild();
+            /**
+             * @brief Builds the recorded tasks on a worker thread. The new graph replaces the baked one
+             * at the first BeginFrame() after the build finished. Tasks of the replaced graph may be freed
+             * once IsRebuildPending() returns false.
+             */
+            SHOCKGRAPH_API void BuildAsync();
+            PYRO_NODISCARD SHOCKGRAPH_API bool IsRebuildPending() const;
+
+            /**
+             * @brief Sets the scheduler used by the next Build() or Reschedule(). nullptr uses the DefaultTaskScheduler.
+             */
+            SHOCKGRAPH_API void SetScheduler(ITaskScheduler* scheduler);
+            /**
+             * @brief Runs the scheduler again on the baked graph, weighting tasks with their latest GPU timings.
+             * Dependencies are kept, only the batches and barriers are rebuilt. Must be called outside of a frame.
+             * Only the active variant is rescheduled.
+             */
+            SHOCKGRAPH_API void Reschedule();
+
             SHOCKGRAPH_API void BeginFrame(u32 timeoutMilliseconds = 1000);
+            /**
+             * @brief Begins a frame only if a frame slot frees up within the timeout, 0 does not block.
+             * Unlike BeginFrame(), a GPU that does not finish in time is not fatal.
+             * @return false if every frame slot is still in use by the GPU, no frame was started.
+             */
+            PYRO_NODISCARD SHOCKGRAPH_API bool TryBeginFrame(u32 timeoutMilliseconds = 0);
+            /**
+             * @brief Whether the next BeginFrame() would return without waiting for the GPU.
+             */
+            PYRO_NODISCARD SHOCKGRAPH_API bool IsFrameSlotFree() const;
+            /**
+             * @brief Sets a callback invoked from a worker thread whenever the GPU finishes a frame, in frame order.
+             * Only frames ended after the callback was set are reported. Every ended frame must be submitted.
+             */
+            SHOCKGRAPH_API void SetFrameSlotCallback(TaskFrameSlotCallback&& callback);
+            /**
+             * @brief Returns the pacing measurements of the current frame, or of the last frame outside of one.
+             */
+            PYRO_NODISCARD SHOCKGRAPH_API TaskFrameStats GetFrameStats() const;
+            /**
+             * @brief Copies a buffer region into a pooled readback page after the last batch of the current frame.
+             * The callback runs in the first BeginFrame() or PollReadbacks() after the GPU finished the frame.
+             * Must be called inside of a frame, before Execute().
+             */
+            SHOCKGRAPH_API void RequestReadback(const TaskBufferReadbackInfo& info);
+            /**
+             * @brief Copies an image region into a pooled readback page after the last batch of the current frame,
+             * see the buffer overload.
+             */
+            SHOCKGRAPH_API void RequestReadback(const TaskImageReadbackInfo& info);
+            /**
+             * @brief Runs the callbacks of every readback whose frame the GPU has finished.
+             */
+            SHOCKGRAPH_API void PollReadbacks();
             /**
              * @return the submit and present info. This must be submitted to the IDevice manually.
              */
@@ -151,54 +371,224 @@ namespace PyroshockStudios {
              * @brief Returns the GPU timeline fence. You may wait for this, but do NOT modify timeline values!
              */
             PYRO_NODISCARD SHOCKGRAPH_API IFence* GetTimelineFence();
+            /**
+             * @brief Returns the last value signalled on the submit timeline, which advances once per submitted chunk.
+             */
+            PYRO_NODISCARD SHOCKGRAPH_API u64 GetSubmitTimelineValue() const;
+            /**
+             * @brief Returns the submit timeline fence. You may wait for this, but do NOT modify timeline values!
+             */
+            PYRO_NODISCARD SHOCKGRAPH_API IFence* GetSubmitTimelineFence();
 
 
             PYRO_NODISCARD SHOCKGRAPH_API eastl::string ToString() const;
             SHOCKGRAPH_API TaskGraphDebugInfo GetDebugInfo() const;
+            /**
+             * @brief Captures the task setups, used resources, GPU timings and schedule of the active variant,
+             * to be saved with SaveTaskGraphCapture() and rebuilt through TaskScheduleReplay. No commands are captured.
+             */
+            PYRO_NODISCARD SHOCKGRAPH_API TaskGraphCapture CaptureSchedule() const;
 
         private:
+            PYRO_NODISCARD f64 GetTaskTimingsNs(TaskId taskIndex) const;
+            PYRO_NODISCARD eastl::vector<TaskScheduleNode> BuildScheduleNodes() const;
+            void ScheduleBatches();
+            void BuildBarriers();
+            void BuildSubmitChunks();
+            void AcquireSwapChains();
+            void CreateTimestampPools();
+            void RecordReadbacks(ICommandBuffer* commandBuffer);
+            PYRO_NODISCARD eastl::pair<u32, usize> AllocateReadback(usize size);
+            void ReleaseReadbackPages();
+            void WaitForPendingBuild();
+            void ResizeFramesInFlight(u32 framesInFlight);
+            PYRO_NODISCARD u64 GetFrameSlotWaitValue() const;
+            PYRO_NODISCARD bool BeginFrameWithin(u32 timeoutMilliseconds);
+            void RunFrameSlotWaiter();
+            void InstallPendingBuild();
+            void BakeVariant();
+            void AnalyseSubgraphs();
+            PYRO_NODISCARD TaskAccessType GetFinalAccess(u32 resourceId, bool bExecuted) const;
+            void RecordHandOffBarriers(ICommandBuffer* commandBuffer);
+            PYRO_NODISCARD u64 ComputeSetupHash() const;
+            PYRO_NODISCARD bool LoadScheduleCache(u64 setupHash);
+            void SaveScheduleCache(u64 setupHash) const;
+            void AssignResourceVersions(const eastl::vector<eastl::vector<u32>>& bufferVersions, const eastl::vector<eastl::vector<u32>>& imageVersions,
+                const eastl::vector<bool>& loadsPreviousFrame);
+
             void FlushStagingBuffers(ICommandBuffer* commandBuffer);
             void FlushDynamicBuffers(ICommandBuffer* commandBuffer);
+            void GenerateUploadedMips(ICommandBuffer* commandBuffer, const TaskResourceManager::StagingUploadData& stagingUpload);
 
             IDevice* mDevice = {};
             TaskResourceManager* mResourceManager = {};
+            ITaskScheduler* mScheduler = nullptr;
 
+            // task a barrier was built for. Foldable barriers are followed by another barrier of the same resource
+            // (or none at all), so when the task is skipped the next barrier can transition from this one's source instead
+            struct BarrierOwner {
+                TaskId task = {};
+                bool bFoldable = true;
+            };
             struct BatchBarrier {
                 eastl::vector<BufferMemoryBarrierInfo> buffer = {};
                 eastl::vector<ImageMemoryBarrierInfo> image = {};
                 // for mutating barriers e.g. swap chain
                 eastl::vector<eastl::function<ImageMemoryBarrierInfo()>> imageLambda = {};
                 eastl::vector<AccelerationStructureBarrierInfo> accelerationStructure = {};
+                // parallel to the vectors above, acceleration structure barriers are never folded
+                eastl::vector<BarrierOwner> bufferOwners = {};
+                eastl::vector<BarrierOwner> imageOwners = {};
+                eastl::vector<BarrierOwner> imageLambdaOwners = {};
             };
             struct Batch {
                 eastl::vector<TaskId> taskIds = {};
                 BatchBarrier barriers = {};
+                bool bTouchesSwapChain = false;
+                bool bTouchesHandOff = false;
+            };
+            // schedule of a variant, the active one is swapped into mBatches, mTaskEdges, ...
+            struct TaskVariant {
+                eastl::vector<GenericTask*> tasks = {};
+                bool bAllTasks = false;
+                eastl::vector<bool> enabledTasks = {};
+                eastl::vector<Batch> batches = {};
+                eastl::vector<TaskDebugEdges> edges = {};
+                eastl::vector<u32> chunkEndBatches = {};
             };
+            void SwapVariant(TaskVariant& variant);
+            PYRO_NODISCARD static bool IsLegalSchedule(const TaskVariant& variant);
+            PYRO_NODISCARD PYRO_FORCEINLINE bool IsTaskEnabled(TaskId taskIndex) const {
+                return mEnabledTasks.empty() || mEnabledTasks[taskIndex];
+            }
 
             ICommandQueue* mQueue = nullptr;
             eastl::vector<ICommandBuffer*> mPendingCommands = {};
 
             eastl::vector<eastl::unique_ptr<GenericTask>> mInternalTasks = {};
             eastl::vector<Batch> mBatches = {};
+            // batch index every early submitted chunk ends at
+            eastl::vector<u32> mChunkEndBatches = {};
             eastl::vector<TaskDebugEdges> mTaskEdges = {};
+            // empty if every task is enabled
+            eastl::vector<bool> mEnabledTasks = {};
+            eastl::vector<TaskVariant> mVariants = {};
+            TaskVariantId mActiveVariant = 0;
+            TaskVariantId mRequestedVariant = 0;
+
+            struct SubgraphInstance {
+                TaskSubgraph* subgraph = nullptr;
+                TaskId firstTask = 0;
+                u32 taskCount = 0;
+                // resource id of every binding
+                eastl::vector<u32> bindings = {};
+            };
+            PYRO_NODISCARD u32 SubgraphSlotResource(const SubgraphInstance& instance, u32 slot) const;
+            PYRO_NODISCARD bool MatchesSubgraphTemplate(const SubgraphInstance& instance) const;
+            eastl::vector<SubgraphInstance> mSubgraphInstances = {};
+            // subgraph copy every task belongs to, empty if no copy can reuse its subgraph's analysis
+            eastl::vector<u32> mTaskSubgraphInstances = {};
+            TaskSubgraph* mRecordingSubgraph = nullptr;
+            TaskId mRecordingSubgraphFirstTask = 0;
+            eastl::vector<u32> mRecordingSubgraphBindings = {};
+
+            struct HandOff {
+                TaskGraph* producer = nullptr;
+                eastl::vector<TaskBuffer> buffers = {};
+                eastl::vector<TaskImage> images = {};
+            };
+            eastl::vector<HandOff> mHandOffs = {};
+            // access every handed off resource starts the frame in, taken from its producer's full schedule at Build()
+            struct ImportedAccess {
+                TaskGraph* producer = nullptr;
+                TaskBuffer buffer = {};
+                TaskImage image = {};
+                TaskAccessType access = {};
+            };
+            eastl::vector<ImportedAccess> mImportedAccesses = {};
 
             eastl::vector<TaskExecute*> mTasks = {};
+            // tasks disabled for the frame being executed
+            eastl::vector<bool> mSkippedTasks = {};
             eastl::vector<TaskSwapChain> mSwapChains = {};
 
+            // extra allocations backing renamed resource versions, the command list records into them in place of the resource
+            eastl::vector<TaskShadowResource> mShadowResources = {};
+            eastl::vector<RenderTarget> mShadowRenderTargets = {};
+            // resources renamed by the baked graph, views of their raw handles cannot be created until Reset()
+            eastl::vector<TaskBuffer> mVersionedBuffers = {};
+            eastl::vector<TaskImage> mVersionedImages = {};
+
             eastl::vector<GenericTask*> mAllTaskRefs = {};
             u32 mBaseGraphTimestampIndex = 0;
             u32 mBaseMiscFlushesTimestampIndex = 0;
 
             IFence* mGpuFrameTimeline;
+            IFence* mSubmitTimeline;
             eastl::vector<ITimestampQueryPool*> mTimestampQueryPools;
 
             u32 mFrameIndex = 0;
             u32 mFramesInFlight = 0;
             u64 mCpuTimelineIndex = 0;
+            // latest frame started by BeginFrame(), no frame recorded later reads a resource released before
+            std::atomic<u64> mBegunCpuTimelineIndex = 0;
+            // last frame handed to the application by EndFrame(), its timeline value will be signalled without further recording
+            std::atomic<u64> mEndedCpuTimelineIndex = 0;
+            u32 mSubmitChunkCount = 1;
+            u64 mSubmitTimelineIndex = 0;
             bool bInFrame = false;
             bool bBaked = false;
+            bool bResourceVersioning = false;
+            eastl::string mScheduleCachePath = {};
+            bool bLateSwapChainAcquire = false;
+            bool bLowLatencyPacing = false;
+            bool bSwapChainsAcquired = false;
+            // per draw constants of the frame being recorded, one set of buffers per frame in flight
+            TransientUniformPool mTransientUniforms;
+
+            TaskFrameStats mFrameStats = {};
+            std::chrono::steady_clock::time_point mFrameStartTime = {};
+            TaskFrameSlotCallback mFrameSlotCallback = {};
+            // ended frames waiting for their callback, drained in order by a single waiter thread
+            std::thread mFrameSlotWaiter = {};
+            std::mutex mFrameSlotLock = {};
+            std::condition_variable mFrameSlotSignal = {};
+            eastl::deque<u64> mPendingFrameSlots = {};
+            std::atomic<bool> mbStopFrameSlotWaiter = false;
+
+            struct ReadbackPage {
+                Buffer buffer = PYRO_NULL_BUFFER;
+                usize size = 0;
+                usize used = 0;
+                // readbacks still waiting for their callback, the page is only reused once this is 0
+                u32 pendingCount = 0;
+            };
+            struct PendingReadback {
+                u64 frame = 0;
+                u32 page = 0;
+                usize offset = 0;
+                usize size = 0;
+                TaskBuffer srcBuffer = {};
+                usize srcOffset = 0;
+                TaskImage srcImage = {};
+                ImageArraySlice srcImageSlice = {};
+                Extent3D srcImageExtent = {};
+                u32 rowPitch = 0;
+                TaskReadbackCallback callback = {};
+            };
+            eastl::vector<ReadbackPage> mReadbackPages = {};
+            // page the readbacks of the current frame are allocated from
+            u32 mCurrentReadbackPage = ~0U;
+            eastl::vector<PendingReadback> mRecordedReadbacks = {};
+            eastl::vector<PendingReadback> mQueuedReadbacks = {};
+
+            eastl::unique_ptr<TaskGraph> mPendingGraph = nullptr;
+            std::future<void> mPendingBuild = {};
+            bool bRecordingRebuild = false;
 
             ILogStream* mLogStream = nullptr;
+
+            friend class TaskResourceManager;
         };
     } // namespace ShockGraph
 } // namespace PyroshockStudios
\ No newline at end of file
@@ -0,0 +1,271 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "TaskGraph.hpp"
+#include "TaskScheduler.hpp"
+#include <PyroCommon/Logger.hpp>
+
+#include <EASTL/algorithm.h>
+#include <fstream>
+#include <libassert/assert.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        // The cache is a flat array of u32 words in native byte order, so it can be mapped and read in place:
+        //   header: magic, version, setup hash (lo, hi), task count, variant count
+        //   per variant, per task: dependency count, dependencies..., dependent count, dependents...
+        //   per variant: batch count, per batch: task count, task ids..., chunk end count, chunk end batches...
+        // Barriers are not stored, they reference live resource handles and are rebuilt in a single pass on load.
+        constexpr u32 SCHEDULE_CACHE_MAGIC = 0x43544753; // "SGTC"
+        constexpr u32 SCHEDULE_CACHE_VERSION = 2;
+
+        struct ScheduleCacheReader {
+            const eastl::vector<u32>& words;
+            usize cursor = 0;
+
+            PYRO_NODISCARD bool Read(u32& value) {
+                if (cursor >= words.size()) {
+                    return false;
+                }
+                value = words[cursor++];
+                return true;
+            }
+            PYRO_NODISCARD bool ReadIds(eastl::vector<TaskId>& ids, u32 maxId) {
+                u32 count = 0;
+                if (!Read(count) || count > words.size() - cursor) {
+                    return false;
+                }
+                ids.resize(count);
+                for (TaskId& id : ids) {
+                    if (!Read(id) || id >= maxId) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        };
+        static void WriteIds(eastl::vector<u32>& words, const eastl::vector<TaskId>& ids) {
+            words.push_back(static_cast<u32>(ids.size()));
+            words.insert(words.end(), ids.begin(), ids.end());
+        }
+
+        struct SetupHasher {
+            u64 hash = 0xcbf29ce484222325ull;
+            // accesses are hashed by order of first appearance, as only their equality changes the schedule
+            eastl::vector<TaskAccessType> accesses = {};
+
+            void Add(u32 value) {
+                for (u32 i = 0; i < 4; ++i) {
+                    hash ^= (value >> (i * 8)) & 0xFF;
+                    hash *= 0x100000001b3ull;
+                }
+            }
+            void Add(const eastl::string& string) {
+                Add(static_cast<u32>(string.size()));
+                for (char c : string) {
+                    Add(static_cast<u32>(static_cast<u8>(c)));
+                }
+            }
+            void Add(TaskAccessType access) {
+                auto it = eastl::find(accesses.begin(), accesses.end(), access);
+                if (it == accesses.end()) {
+                    accesses.push_back(access);
+                    it = accesses.end() - 1;
+                }
+                Add(static_cast<u32>(it - accesses.begin()));
+            }
+        };
+
+        u64 TaskGraph::ComputeSetupHash() const {
+            SetupHasher hasher = {};
+            hasher.Add(SCHEDULE_CACHE_VERSION);
+            hasher.Add(static_cast<u32>(mTasks.size()));
+            hasher.Add(mSubmitChunkCount);
+            // keyed by the scheduler's own name instead of its RTTI name, which differs between compilers
+            const DefaultTaskScheduler defaultScheduler = {};
+            const ITaskScheduler& scheduler = mScheduler ? *mScheduler : defaultScheduler;
+            hasher.Add(eastl::string(scheduler.GetName()));
+            hasher.Add(scheduler.GetVersion());
+            // task refs are kept in the same order as mTasks
+            for (GenericTask* task : mAllTaskRefs) {
+                hasher.Add(static_cast<u32>(task->GetType()));
+                hasher.Add(static_cast<u32>(task->mSetupData.bufferDepends.size()));
+                for (const auto& bufferDep : task->mSetupData.bufferDepends) {
+                    hasher.Add(bufferDep.buffer->GetId());
+                    hasher.Add(bufferDep.access);
+                    hasher.Add(bufferDep.reservedBytes);
+                }
+                hasher.Add(static_cast<u32>(task->mSetupData.imageDepends.size()));
+                for (const auto& imageDep : task->mSetupData.imageDepends) {
+                    hasher.Add(imageDep.image->GetId());
+                    hasher.Add(imageDep.access);
+                    hasher.Add(imageDep.reservedBytes);
+                }
+                hasher.Add(static_cast<u32>(task->mSetupData.accelerationStructureDepends.size()));
+                for (const auto& asDep : task->mSetupData.accelerationStructureDepends) {
+                    if (eastl::holds_alternative<TaskBlas>(asDep.accelerationStructure)) {
+                        hasher.Add(eastl::get<TaskBlas>(asDep.accelerationStructure)->GetId());
+                    } else {
+                        hasher.Add(eastl::get<TaskTlas>(asDep.accelerationStructure)->GetId());
+                    }
+                    hasher.Add(asDep.access);
+                }
+            }
+            hasher.Add(static_cast<u32>(mVariants.size()));
+            for (const TaskVariant& variant : mVariants) {
+                hasher.Add(static_cast<u32>(variant.bAllTasks));
+                for (TaskId taskIndex = 0; taskIndex < mTasks.size() && !variant.bAllTasks; ++taskIndex) {
+                    GenericTask* task = mAllTaskRefs[taskIndex];
+                    hasher.Add(static_cast<u32>(eastl::find(variant.tasks.begin(), variant.tasks.end(), task) != variant.tasks.end()));
+                }
+            }
+            return hasher.hash;
+        }
+
+        bool TaskGraph::LoadScheduleCache(u64 setupHash) {
+            std::ifstream file{ mScheduleCachePath.c_str(), std::ios::binary | std::ios::ate };
+            if (!file) {
+                return false;
+            }
+            const std::streamsize size = file.tellg();
+            if (size <= 0 || size % sizeof(u32) != 0) {
+                return false;
+            }
+            eastl::vector<u32> words(static_cast<usize>(size) / sizeof(u32));
+            file.seekg(0);
+            if (!file.read(reinterpret_cast<char*>(words.data()), size)) {
+                return false;
+            }
+
+            ScheduleCacheReader reader = { .words = words };
+            const u32 taskCount = static_cast<u32>(mTasks.size());
+            u32 magic = 0, version = 0, hashLo = 0, hashHi = 0, cachedTaskCount = 0, variantCount = 0;
+            if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(hashLo) || !reader.Read(hashHi) ||
+                !reader.Read(cachedTaskCount) || !reader.Read(variantCount)) {
+                return false;
+            }
+            if (magic != SCHEDULE_CACHE_MAGIC || version != SCHEDULE_CACHE_VERSION || (static_cast<u64>(hashHi) << 32 | hashLo) != setupHash ||
+                cachedTaskCount != taskCount || variantCount != mVariants.size()) {
+                Logger::Trace(mLogStream, "Schedule cache '{}' is stale", mScheduleCachePath);
+                return false;
+            }
+
+            for (TaskVariant& variant : mVariants) {
+                variant.edges.clear();
+                variant.edges.resize(taskCount);
+                for (TaskDebugEdges& edges : variant.edges) {
+                    if (!reader.ReadIds(edges.dependencies, taskCount) || !reader.ReadIds(edges.dependents, taskCount)) {
+                        return false;
+                    }
+                }
+                u32 batchCount = 0;
+                if (!reader.Read(batchCount) || batchCount > words.size()) {
+                    return false;
+                }
+                variant.batches.clear();
+                variant.batches.resize(batchCount);
+                for (Batch& batch : variant.batches) {
+                    if (!reader.ReadIds(batch.taskIds, taskCount)) {
+                        return false;
+                    }
+                }
+                if (!reader.ReadIds(variant.chunkEndBatches, batchCount + 1)) {
+                    return false;
+                }
+                if (!IsLegalSchedule(variant)) {
+                    Logger::Trace(mLogStream, "Schedule cache '{}' holds an illegal schedule", mScheduleCachePath);
+                    return false;
+                }
+            }
+            return reader.cursor == words.size();
+        }
+
+        // A cache that matches the hash can still be corrupt or written by a buggy scheduler, so the schedule is only installed if every
+        // enabled task runs exactly once, after all of its dependencies, no disabled task runs and the chunk ends split the batches in order.
+        bool TaskGraph::IsLegalSchedule(const TaskVariant& variant) {
+            const auto& edges = variant.edges;
+            const auto& batches = variant.batches;
+            const auto& chunkEndBatches = variant.chunkEndBatches;
+            constexpr u32 UNSCHEDULED = ~0U;
+            eastl::vector<u32> taskBatches(edges.size(), UNSCHEDULED);
+            for (u32 batchIndex = 0; batchIndex < batches.size(); ++batchIndex) {
+                for (TaskId taskId : batches[batchIndex].taskIds) {
+                    if (taskBatches[taskId] != UNSCHEDULED) {
+                        return false;
+                    }
+                    taskBatches[taskId] = batchIndex;
+                }
+            }
+            for (TaskId taskId = 0; taskId < edges.size(); ++taskId) {
+                const bool bEnabled = variant.enabledTasks.empty() || variant.enabledTasks[taskId];
+                if (bEnabled != (taskBatches[taskId] != UNSCHEDULED)) {
+                    return false;
+                }
+                for (TaskId parentId : edges[taskId].dependencies) {
+                    const auto& dependents = edges[parentId].dependents;
+                    if (eastl::find(dependents.begin(), dependents.end(), taskId) == dependents.end()) {
+                        return false;
+                    }
+                    if (taskBatches[taskId] != UNSCHEDULED && (taskBatches[parentId] == UNSCHEDULED || taskBatches[parentId] >= taskBatches[taskId])) {
+                        return false;
+                    }
+                }
+            }
+            for (usize i = 0; i < chunkEndBatches.size(); ++i) {
+                // a chunk end is the first batch of the next chunk, so it never reaches past the last batch
+                if (chunkEndBatches[i] == 0 || chunkEndBatches[i] >= batches.size() || (i > 0 && chunkEndBatches[i] <= chunkEndBatches[i - 1])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void TaskGraph::SaveScheduleCache(u64 setupHash) const {
+            eastl::vector<u32> words = {
+                SCHEDULE_CACHE_MAGIC,
+                SCHEDULE_CACHE_VERSION,
+                static_cast<u32>(setupHash),
+                static_cast<u32>(setupHash >> 32),
+                static_cast<u32>(mTasks.size()),
+                static_cast<u32>(mVariants.size()),
+            };
+            for (const TaskVariant& variant : mVariants) {
+                for (const TaskDebugEdges& edges : variant.edges) {
+                    WriteIds(words, edges.dependencies);
+                    WriteIds(words, edges.dependents);
+                }
+                words.push_back(static_cast<u32>(variant.batches.size()));
+                for (const Batch& batch : variant.batches) {
+                    WriteIds(words, batch.taskIds);
+                }
+                WriteIds(words, variant.chunkEndBatches);
+            }
+
+            std::ofstream file{ mScheduleCachePath.c_str(), std::ios::binary | std::ios::trunc };
+            if (!file.write(reinterpret_cast<const char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(u32)))) {
+                Logger::Trace(mLogStream, "Failed to write schedule cache '{}'", mScheduleCachePath);
+                return;
+            }
+            Logger::Trace(mLogStream, "Wrote schedule cache '{}', {} bytes", mScheduleCachePath, words.size() * sizeof(u32));
+        }
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,442 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "TaskGraphCapture.hpp"
+#include "TaskGraph.hpp"
+
+#include <EASTL/algorithm.h>
+#include <EASTL/hash_map.h>
+#include <cstring>
+#include <fstream>
+#include <libassert/assert.hpp>
+#include <type_traits>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        constexpr u32 CAPTURE_MAGIC = 0x43464753; // "SGFC"
+        constexpr u32 CAPTURE_VERSION = 1;
+        constexpr u32 CAPTURE_SWAPCHAIN_WRITE_FLAG = 0x01;
+
+        // Captures store plain structs byte for byte, they are only meant to be read back by the same build of the library
+        struct CaptureWriter {
+            eastl::vector<u8> bytes = {};
+
+            template <typename T>
+            void Pod(const T& value) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                const u8* data = reinterpret_cast<const u8*>(&value);
+                bytes.insert(bytes.end(), data, data + sizeof(T));
+            }
+            void String(const eastl::string& string) {
+                Pod(static_cast<u32>(string.size()));
+                bytes.insert(bytes.end(), string.begin(), string.end());
+            }
+            void Ids(const eastl::vector<TaskId>& ids) {
+                Pod(static_cast<u32>(ids.size()));
+                for (TaskId id : ids) {
+                    Pod(id);
+                }
+            }
+            void Dependencies(const eastl::vector<TaskCaptureDependency>& dependencies) {
+                Pod(static_cast<u32>(dependencies.size()));
+                for (const auto& dependency : dependencies) {
+                    Pod(dependency.resource);
+                    Pod(dependency.access);
+                    Pod(dependency.reservedBytes);
+                }
+            }
+        };
+        struct CaptureReader {
+            const eastl::vector<u8>& bytes;
+            usize cursor = 0;
+
+            template <typename T>
+            PYRO_NODISCARD bool Pod(T& value) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                if (bytes.size() - cursor < sizeof(T)) {
+                    return false;
+                }
+                memcpy(&value, bytes.data() + cursor, sizeof(T));
+                cursor += sizeof(T);
+                return true;
+            }
+            PYRO_NODISCARD bool Count(u32& count, usize elementSize) {
+                return Pod(count) && count <= (bytes.size() - cursor) / elementSize;
+            }
+            PYRO_NODISCARD bool String(eastl::string& string) {
+                u32 size = 0;
+                if (!Count(size, 1)) {
+                    return false;
+                }
+                string.assign(reinterpret_cast<const char*>(bytes.data() + cursor), size);
+                cursor += size;
+                return true;
+            }
+            PYRO_NODISCARD bool Ids(eastl::vector<TaskId>& ids, u32 maxId) {
+                u32 count = 0;
+                if (!Count(count, sizeof(TaskId))) {
+                    return false;
+                }
+                ids.resize(count);
+                for (TaskId& id : ids) {
+                    if (!Pod(id) || id >= maxId) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            // dependencies must reference a resource of one of the given types, the replay indexes its resources by them
+            PYRO_NODISCARD bool Dependencies(eastl::vector<TaskCaptureDependency>& dependencies, const eastl::vector<TaskCaptureResource>& resources,
+                TaskCaptureResourceType type, TaskCaptureResourceType otherType) {
+                u32 count = 0;
+                if (!Count(count, sizeof(u32))) {
+                    return false;
+                }
+                dependencies.resize(count);
+                for (auto& dependency : dependencies) {
+                    if (!Pod(dependency.resource) || !Pod(dependency.access) || !Pod(dependency.reservedBytes) || dependency.resource >= resources.size()) {
+                        return false;
+                    }
+                    const TaskCaptureResourceType resourceType = resources[dependency.resource].type;
+                    if (resourceType != type && resourceType != otherType) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        };
+
+        TaskGraphCapture TaskGraph::CaptureSchedule() const {
+            ASSERT(bBaked, "Build() must be called before capturing a task graph!");
+            TaskGraphCapture capture = {};
+
+            eastl::hash_map<u32, u32> resourceIndices = {};
+            auto captureResource = [&](TaskResource_* resource, auto&& describe) -> u32 {
+                auto [it, bInserted] = resourceIndices.insert(eastl::make_pair(resource->GetId(), static_cast<u32>(capture.resources.size())));
+                if (bInserted) {
+                    capture.resources.emplace_back();
+                    describe(capture.resources.back());
+                }
+                return it->second;
+            };
+
+            capture.tasks.resize(mAllTaskRefs.size());
+            for (TaskId taskIndex = 0; taskIndex < mAllTaskRefs.size(); ++taskIndex) {
+                GenericTask* task = mAllTaskRefs[taskIndex];
+                TaskCaptureTask& captured = capture.tasks[taskIndex];
+                captured.name = task->Info().name;
+                captured.type = task->GetType();
+                captured.timingNs = mTimestampQueryPools.empty() || !IsTaskEnabled(taskIndex) ? 0.0 : GetTaskTimingsNs(taskIndex);
+                captured.bInternal = eastl::any_of(mInternalTasks.begin(), mInternalTasks.end(), [task](const auto& internalTask) { return internalTask.get() == task; });
+
+                for (const auto& bufferDep : task->mSetupData.bufferDepends) {
+                    const u32 resource = captureResource(bufferDep.buffer.Get(), [&](TaskCaptureResource& out) {
+                        out.type = TaskCaptureResourceType::Buffer;
+                        out.buffer = bufferDep.buffer->Info();
+                        out.name = bufferDep.buffer->Info().name;
+                    });
+                    captured.bufferDepends.push_back({ .resource = resource, .access = bufferDep.access, .reservedBytes = bufferDep.reservedBytes });
+                }
+                for (const auto& imageDep : task->mSetupData.imageDepends) {
+                    const u32 resource = captureResource(imageDep.image.Get(), [&](TaskCaptureResource& out) {
+                        out.type = imageDep.image->IsSwapChainOwned() ? TaskCaptureResourceType::SwapChainImage : TaskCaptureResourceType::Image;
+                        out.image = imageDep.image->Info();
+                        out.name = imageDep.image->Info().name;
+                    });
+                    captured.imageDepends.push_back({ .resource = resource, .access = imageDep.access, .reservedBytes = imageDep.reservedBytes });
+                }
+                for (const auto& asDep : task->mSetupData.accelerationStructureDepends) {
+                    u32 resource = 0;
+                    if (eastl::holds_alternative<TaskBlas>(asDep.accelerationStructure)) {
+                        const TaskBlas& blas = eastl::get<TaskBlas>(asDep.accelerationStructure);
+                        resource = captureResource(blas.Get(), [&](TaskCaptureResource& out) {
+                            out.type = TaskCaptureResourceType::Blas;
+                            out.size = blas->Info().size;
+                            out.name = blas->Info().name;
+                        });
+                    } else {
+                        const TaskTlas& tlas = eastl::get<TaskTlas>(asDep.accelerationStructure);
+                        resource = captureResource(tlas.Get(), [&](TaskCaptureResource& out) {
+                            out.type = TaskCaptureResourceType::Tlas;
+                            out.size = tlas->Info().size;
+                            out.name = tlas->Info().name;
+                        });
+                    }
+                    captured.accelerationStructureDepends.push_back({ .resource = resource, .access = asDep.access, .reservedBytes = asDep.reservedBytes });
+                }
+            }
+
+            capture.dependencies.resize(mTaskEdges.size());
+            capture.dependents.resize(mTaskEdges.size());
+            for (usize taskIndex = 0; taskIndex < mTaskEdges.size(); ++taskIndex) {
+                capture.dependencies[taskIndex] = mTaskEdges[taskIndex].dependencies;
+                capture.dependents[taskIndex] = mTaskEdges[taskIndex].dependents;
+            }
+            for (const Batch& batch : mBatches) {
+                capture.batches.push_back(batch.taskIds);
+            }
+            return capture;
+        }
+
+        bool SaveTaskGraphCapture(const TaskGraphCapture& capture, const eastl::string& path) {
+            CaptureWriter writer = {};
+            writer.Pod(CAPTURE_MAGIC);
+            writer.Pod(CAPTURE_VERSION);
+
+            writer.Pod(static_cast<u32>(capture.resources.size()));
+            for (const TaskCaptureResource& resource : capture.resources) {
+                writer.Pod(resource.type);
+                writer.String(resource.name);
+                writer.Pod(static_cast<u64>(resource.buffer.size));
+                writer.Pod(resource.buffer.usage);
+                writer.Pod(resource.buffer.mode);
+                writer.Pod(resource.image.flags);
+                writer.Pod(resource.image.dimensions);
+                writer.Pod(resource.image.format);
+                writer.Pod(resource.image.size);
+                writer.Pod(resource.image.mipLevelCount);
+                writer.Pod(resource.image.arrayLayerCount);
+                writer.Pod(resource.image.sampleCount);
+                writer.Pod(resource.image.usage);
+                writer.Pod(static_cast<u64>(resource.size));
+            }
+
+            writer.Pod(static_cast<u32>(capture.tasks.size()));
+            for (usize taskIndex = 0; taskIndex < capture.tasks.size(); ++taskIndex) {
+                const TaskCaptureTask& task = capture.tasks[taskIndex];
+                writer.String(task.name);
+                writer.Pod(task.type);
+                writer.Pod(task.timingNs);
+                writer.Pod(static_cast<u32>(task.bInternal));
+                writer.Dependencies(task.bufferDepends);
+                writer.Dependencies(task.imageDepends);
+                writer.Dependencies(task.accelerationStructureDepends);
+                writer.Ids(capture.dependencies[taskIndex]);
+                writer.Ids(capture.dependents[taskIndex]);
+            }
+
+            writer.Pod(static_cast<u32>(capture.batches.size()));
+            for (const auto& batch : capture.batches) {
+                writer.Ids(batch);
+            }
+
+            std::ofstream file{ path.c_str(), std::ios::binary | std::ios::trunc };
+            return static_cast<bool>(file.write(reinterpret_cast<const char*>(writer.bytes.data()), static_cast<std::streamsize>(writer.bytes.size())));
+        }
+
+        bool LoadTaskGraphCapture(const eastl::string& path, TaskGraphCapture& capture) {
+            std::ifstream file{ path.c_str(), std::ios::binary | std::ios::ate };
+            if (!file) {
+                return false;
+            }
+            const std::streamsize size = file.tellg();
+            if (size <= 0) {
+                return false;
+            }
+            eastl::vector<u8> bytes(static_cast<usize>(size));
+            file.seekg(0);
+            if (!file.read(reinterpret_cast<char*>(bytes.data()), size)) {
+                return false;
+            }
+
+            CaptureReader reader = { .bytes = bytes };
+            u32 magic = 0, version = 0;
+            if (!reader.Pod(magic) || !reader.Pod(version) || magic != CAPTURE_MAGIC || version != CAPTURE_VERSION) {
+                return false;
+            }
+
+            capture = {};
+            u32 resourceCount = 0;
+            if (!reader.Count(resourceCount, sizeof(u32))) {
+                return false;
+            }
+            capture.resources.resize(resourceCount);
+            for (TaskCaptureResource& resource : capture.resources) {
+                u64 bufferSize = 0, asSize = 0;
+                if (!reader.Pod(resource.type) || !reader.String(resource.name) || !reader.Pod(bufferSize) ||
+                    !reader.Pod(resource.buffer.usage) || !reader.Pod(resource.buffer.mode) || !reader.Pod(resource.image.flags) ||
+                    !reader.Pod(resource.image.dimensions) || !reader.Pod(resource.image.format) || !reader.Pod(resource.image.size) ||
+                    !reader.Pod(resource.image.mipLevelCount) || !reader.Pod(resource.image.arrayLayerCount) ||
+                    !reader.Pod(resource.image.sampleCount) || !reader.Pod(resource.image.usage) || !reader.Pod(asSize)) {
+                    return false;
+                }
+                if (static_cast<u32>(resource.type) > static_cast<u32>(TaskCaptureResourceType::Tlas)) {
+                    return false;
+                }
+                resource.buffer.size = static_cast<usize>(bufferSize);
+                resource.buffer.name = resource.name;
+                resource.image.name = resource.name;
+                resource.size = static_cast<usize>(asSize);
+            }
+
+            u32 taskCount = 0;
+            if (!reader.Count(taskCount, sizeof(u32))) {
+                return false;
+            }
+            capture.tasks.resize(taskCount);
+            capture.dependencies.resize(taskCount);
+            capture.dependents.resize(taskCount);
+            for (u32 taskIndex = 0; taskIndex < taskCount; ++taskIndex) {
+                TaskCaptureTask& task = capture.tasks[taskIndex];
+                u32 bInternal = 0;
+                if (!reader.String(task.name) || !reader.Pod(task.type) || !reader.Pod(task.timingNs) || !reader.Pod(bInternal) ||
+                    static_cast<u32>(task.type) > static_cast<u32>(TaskType::Transfer) ||
+                    !reader.Dependencies(task.bufferDepends, capture.resources, TaskCaptureResourceType::Buffer, TaskCaptureResourceType::Buffer) ||
+                    !reader.Dependencies(task.imageDepends, capture.resources, TaskCaptureResourceType::Image, TaskCaptureResourceType::SwapChainImage) ||
+                    !reader.Dependencies(task.accelerationStructureDepends, capture.resources, TaskCaptureResourceType::Blas, TaskCaptureResourceType::Tlas) ||
+                    !reader.Ids(capture.dependencies[taskIndex], taskCount) || !reader.Ids(capture.dependents[taskIndex], taskCount)) {
+                    return false;
+                }
+                task.bInternal = bInternal != 0;
+            }
+
+            u32 batchCount = 0;
+            if (!reader.Count(batchCount, sizeof(u32))) {
+                return false;
+            }
+            capture.batches.resize(batchCount);
+            for (auto& batch : capture.batches) {
+                if (!reader.Ids(batch, taskCount)) {
+                    return false;
+                }
+            }
+            return reader.cursor == bytes.size();
+        }
+
+        eastl::vector<TaskScheduleNode> BuildCaptureScheduleNodes(const TaskGraphCapture& capture) {
+            // same barrier counting as the task graph, every use of a resource follows the previous one in id order
+            eastl::vector<TaskAccessType> lastAccess(capture.resources.size(), TaskAccessType{});
+            eastl::vector<TaskScheduleNode> nodes(capture.tasks.size());
+            for (usize taskIndex = 0; taskIndex < capture.tasks.size(); ++taskIndex) {
+                const TaskCaptureTask& task = capture.tasks[taskIndex];
+                TaskScheduleNode& node = nodes[taskIndex];
+                node.type = task.type;
+                node.weightNs = task.timingNs;
+                node.dependencies = capture.dependencies[taskIndex];
+                node.dependents = capture.dependents[taskIndex];
+
+                auto countBarrier = [&](const TaskCaptureDependency& dependency) {
+                    if (dependency.reservedBytes & CAPTURE_SWAPCHAIN_WRITE_FLAG) {
+                        ++node.barrierCount;
+                    } else if (lastAccess[dependency.resource] != dependency.access) {
+                        lastAccess[dependency.resource] = dependency.access;
+                        ++node.barrierCount;
+                    }
+                };
+                for (const auto& dependency : task.bufferDepends) {
+                    countBarrier(dependency);
+                }
+                for (const auto& dependency : task.imageDepends) {
+                    countBarrier(dependency);
+                }
+                for (const auto& dependency : task.accelerationStructureDepends) {
+                    countBarrier(dependency);
+                }
+            }
+            return nodes;
+        }
+
+        TaskSchedule ScheduleTaskGraphCapture(const TaskGraphCapture& capture, ITaskScheduler& scheduler) {
+            // as soon as possible batching of the tasks that were scheduled in the captured frame
+            eastl::vector<bool> bScheduled(capture.tasks.size(), false);
+            for (const auto& batch : capture.batches) {
+                for (TaskId taskIndex : batch) {
+                    bScheduled[taskIndex] = true;
+                }
+            }
+            TaskSchedule schedule = {};
+            eastl::vector<u32> asapBatch(capture.tasks.size(), 0);
+            for (TaskId taskIndex = 0; taskIndex < capture.tasks.size(); ++taskIndex) {
+                if (!bScheduled[taskIndex]) {
+                    continue;
+                }
+                u32 batchIndex = 0;
+                for (TaskId parent : capture.dependencies[taskIndex]) {
+                    batchIndex = eastl::max(batchIndex, asapBatch[parent] + 1);
+                }
+                asapBatch[taskIndex] = batchIndex;
+                if (schedule.size() <= batchIndex) {
+                    schedule.resize(batchIndex + 1);
+                }
+                schedule[batchIndex].push_back(taskIndex);
+            }
+
+            eastl::vector<TaskScheduleNode> nodes = BuildCaptureScheduleNodes(capture);
+            scheduler.Schedule({ .tasks = nodes }, schedule);
+            return schedule;
+        }
+
+        TaskScheduleReplay::TaskScheduleReplay(TaskResourceManager* resourceManager, const TaskGraphCapture& capture) {
+            const usize resourceCount = capture.resources.size();
+            mBuffers.resize(resourceCount);
+            mImages.resize(resourceCount);
+            mBlases.resize(resourceCount);
+            mTlases.resize(resourceCount);
+            for (usize i = 0; i < resourceCount; ++i) {
+                const TaskCaptureResource& resource = capture.resources[i];
+                switch (resource.type) {
+                case TaskCaptureResourceType::Buffer:
+                    mBuffers[i] = resourceManager->CreatePersistentBuffer(resource.buffer);
+                    break;
+                case TaskCaptureResourceType::Image:
+                case TaskCaptureResourceType::SwapChainImage:
+                    mImages[i] = resourceManager->CreatePersistentImage(resource.image);
+                    break;
+                case TaskCaptureResourceType::Blas:
+                    mBlases[i] = resourceManager->CreatePersistentBlas({ .size = resource.size, .name = resource.name });
+                    break;
+                case TaskCaptureResourceType::Tlas:
+                    mTlases[i] = resourceManager->CreatePersistentTlas({ .size = resource.size, .name = resource.name });
+                    break;
+                }
+            }
+
+            // internal tasks are replayed too, a graph without swap chains adds none of its own and the ids stay those of the capture
+            for (const TaskCaptureTask& task : capture.tasks) {
+                // swap chain images are regular images in a replay, so the internal flags are dropped
+                auto setup = [this, task](CustomTask& self) {
+                    for (const auto& dependency : task.bufferDepends) {
+                        self.UseBuffer({ .buffer = mBuffers[dependency.resource], .access = dependency.access });
+                    }
+                    for (const auto& dependency : task.imageDepends) {
+                        self.UseImage({ .image = mImages[dependency.resource], .access = dependency.access });
+                    }
+                    for (const auto& dependency : task.accelerationStructureDepends) {
+                        if (mBlases[dependency.resource].Get() != nullptr) {
+                            self.UseAccelerationStructure({ .accelerationStructure = mBlases[dependency.resource], .access = dependency.access });
+                        } else {
+                            self.UseAccelerationStructure({ .accelerationStructure = mTlases[dependency.resource], .access = dependency.access });
+                        }
+                    }
+                };
+                mTasks.emplace_back(eastl::make_unique<CustomCallbackTask>(TaskInfo{ .name = task.name }, eastl::move(setup), [](ICommandBuffer*) {}, task.type));
+            }
+        }
+        TaskScheduleReplay::~TaskScheduleReplay() = default;
+
+        void TaskScheduleReplay::AddTasks(TaskGraph& graph) {
+            for (auto& task : mTasks) {
+                graph.AddTask(task.get());
+            }
+        }
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
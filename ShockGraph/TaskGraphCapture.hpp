@@ -0,0 +1,134 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "ITaskScheduler.hpp"
+#include "Task.hpp"
+#include <EASTL/string.h>
+#include <EASTL/unique_ptr.h>
+#include <EASTL/vector.h>
+#include <ShockGraph/Core.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        class TaskGraph;
+        class TaskResourceManager;
+
+        enum struct TaskCaptureResourceType : u32 {
+            Buffer,
+            Image,
+            SwapChainImage,
+            Blas,
+            Tlas,
+        };
+        struct TaskCaptureResource {
+            TaskCaptureResourceType type = TaskCaptureResourceType::Buffer;
+            TaskBufferInfo buffer = {};
+            TaskImageInfo image = {};
+            /**
+             * @brief Size of acceleration structures.
+             */
+            usize size = 0;
+            eastl::string name = {};
+        };
+        struct TaskCaptureDependency {
+            /**
+             * @brief Index into TaskGraphCapture::resources.
+             */
+            u32 resource = 0;
+            TaskAccessType access = {};
+            u32 reservedBytes = 0;
+        };
+        struct TaskCaptureTask {
+            eastl::string name = {};
+            TaskType type = TaskType::None;
+            /**
+             * @brief GPU time of the task in the captured frame, 0.0 if it was not measured.
+             */
+            f64 timingNs = 0.0;
+            /**
+             * @brief Added by the task graph itself, e.g. swap chain writes. Replays add them as regular tasks with the same
+             * dependencies, so the task ids of a replayed graph match the capture.
+             */
+            bool bInternal = false;
+            eastl::vector<TaskCaptureDependency> bufferDepends = {};
+            eastl::vector<TaskCaptureDependency> imageDepends = {};
+            eastl::vector<TaskCaptureDependency> accelerationStructureDepends = {};
+        };
+        /**
+         * @brief Everything needed to rebuild the schedule of a task graph without the application:
+         * the task setups, the resources they use and the baked schedule of the active variant.
+         * Command streams are not part of a capture, replayed tasks record no work.
+         */
+        struct TaskGraphCapture {
+            eastl::vector<TaskCaptureResource> resources = {};
+            eastl::vector<TaskCaptureTask> tasks = {};
+            /**
+             * @brief Reduced dependency edges, indexed like tasks.
+             */
+            eastl::vector<eastl::vector<TaskId>> dependencies = {};
+            eastl::vector<eastl::vector<TaskId>> dependents = {};
+            TaskSchedule batches = {};
+        };
+
+        PYRO_NODISCARD SHOCKGRAPH_API bool SaveTaskGraphCapture(const TaskGraphCapture& capture, const eastl::string& path);
+        /**
+         * @brief Fails on unreadable files and on captures whose dependencies reference missing resources or resources of the wrong type.
+         */
+        PYRO_NODISCARD SHOCKGRAPH_API bool LoadTaskGraphCapture(const eastl::string& path, TaskGraphCapture& capture);
+
+        /**
+         * @brief Runs a scheduler on a capture without a device, weighting tasks with their captured timings.
+         * The result can be compared against the captured batches with EstimateScheduleTimeNs().
+         */
+        PYRO_NODISCARD SHOCKGRAPH_API TaskSchedule ScheduleTaskGraphCapture(const TaskGraphCapture& capture, ITaskScheduler& scheduler);
+        /**
+         * @brief Scheduling nodes of a capture, for use with EstimateScheduleTimeNs(). The nodes reference the capture.
+         */
+        PYRO_NODISCARD SHOCKGRAPH_API eastl::vector<TaskScheduleNode> BuildCaptureScheduleNodes(const TaskGraphCapture& capture);
+
+        /**
+         * @brief Recreates the resources and task setups of a capture, so its schedule can be built and executed
+         * against any device. Only the schedule is replayed: the tasks record no commands, so the GPU work of
+         * the captured frame is not reproduced. Swap chain images are replaced by regular images of the same size,
+         * and every captured task, internal ones included, is added in capture order so task ids line up with the capture.
+         */
+        class TaskScheduleReplay : DeleteCopy, DeleteMove {
+        public:
+            SHOCKGRAPH_API TaskScheduleReplay(TaskResourceManager* resourceManager, const TaskGraphCapture& capture);
+            SHOCKGRAPH_API ~TaskScheduleReplay();
+
+            /**
+             * @brief Adds every captured task to the graph. The replay must outlive the graph's use of the tasks.
+             */
+            SHOCKGRAPH_API void AddTasks(TaskGraph& graph);
+
+        private:
+            eastl::vector<TaskBuffer> mBuffers = {};
+            eastl::vector<TaskImage> mImages = {};
+            eastl::vector<TaskBlas> mBlases = {};
+            eastl::vector<TaskTlas> mTlases = {};
+            eastl::vector<eastl::unique_ptr<CustomCallbackTask>> mTasks = {};
+        };
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,230 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "TaskGraph.hpp"
+#include <PyroCommon/Logger.hpp>
+#include <PyroRHI/Api/ICommandQueue.hpp>
+#include <PyroRHI/Api/IDevice.hpp>
+
+#include <EASTL/algorithm.h>
+#include <libassert/assert.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        // readbacks of a frame are sub-allocated linearly from a page, larger requests get a page of their own
+        constexpr usize READBACK_PAGE_SIZE = 1024 * 1024;
+        constexpr usize READBACK_ALIGNMENT = 256;
+
+        void TaskGraph::RequestReadback(const TaskBufferReadbackInfo& info) {
+            ASSERT(bInFrame && mPendingCommands.empty(), "Readbacks must be requested inside of a frame, before Execute()!");
+            ASSERT(info.buffer && info.callback, "A readback needs a buffer and a callback!");
+            const usize bufferSize = info.buffer->Info().size;
+            ASSERT(info.region.offset + info.region.size <= bufferSize, "Readback region is out of bounds!");
+            const usize size = info.region.size == 0 ? bufferSize - info.region.offset : info.region.size;
+            auto [page, offset] = AllocateReadback(size);
+            mRecordedReadbacks.push_back({
+                .frame = mCpuTimelineIndex,
+                .page = page,
+                .offset = offset,
+                .size = size,
+                .srcBuffer = info.buffer,
+                .srcOffset = info.region.offset,
+                .callback = info.callback,
+            });
+        }
+        void TaskGraph::RequestReadback(const TaskImageReadbackInfo& info) {
+            ASSERT(bInFrame && mPendingCommands.empty(), "Readbacks must be requested inside of a frame, before Execute()!");
+            ASSERT(info.image && info.callback, "A readback needs an image and a callback!");
+            ASSERT(!info.image->IsSwapChainOwned(), "Swap chain images cannot be read back!");
+            ASSERT(info.rowPitch > 0, "Image readbacks need a row pitch!");
+            const Extent3D extent = info.extent.width == 0 ? info.image->Info().size : info.extent;
+            const usize size = static_cast<usize>(info.rowPitch) * eastl::max(extent.height, 1U) * eastl::max(extent.depth, 1U);
+            auto [page, offset] = AllocateReadback(size);
+            mRecordedReadbacks.push_back({
+                .frame = mCpuTimelineIndex,
+                .page = page,
+                .offset = offset,
+                .size = size,
+                .srcImage = info.image,
+                .srcImageSlice = info.slice,
+                .srcImageExtent = extent,
+                .rowPitch = info.rowPitch,
+                .callback = info.callback,
+            });
+        }
+
+        eastl::pair<u32, usize> TaskGraph::AllocateReadback(usize size) {
+            const usize alignedSize = (size + READBACK_ALIGNMENT - 1) & ~(READBACK_ALIGNMENT - 1);
+            if (mCurrentReadbackPage != ~0U) {
+                ReadbackPage& page = mReadbackPages[mCurrentReadbackPage];
+                if (page.used + alignedSize <= page.size) {
+                    const usize offset = page.used;
+                    page.used += alignedSize;
+                    ++page.pendingCount;
+                    return { mCurrentReadbackPage, offset };
+                }
+            }
+            // reuse the smallest retired page that fits before allocating a new one
+            u32 pageIndex = ~0U;
+            for (u32 i = 0; i < mReadbackPages.size(); ++i) {
+                const ReadbackPage& page = mReadbackPages[i];
+                if (page.pendingCount == 0 && page.size >= alignedSize && (pageIndex == ~0U || page.size < mReadbackPages[pageIndex].size)) {
+                    pageIndex = i;
+                }
+            }
+            if (pageIndex == ~0U) {
+                const usize pageSize = eastl::max(READBACK_PAGE_SIZE, alignedSize);
+                pageIndex = static_cast<u32>(mReadbackPages.size());
+                mReadbackPages.push_back({
+                    .buffer = mDevice->CreateBuffer({
+                        .size = pageSize,
+                        .usage = BufferUsageFlagBits::TRANSFER_DST,
+                        .initialLayout = BufferLayout::TransferDst,
+                        .allocationDomain = MemoryAllocationDomain::HostReadback,
+                        .name = "Task Graph Readback Page #" + eastl::to_string(pageIndex),
+                    }),
+                    .size = pageSize,
+                });
+                Logger::Trace(mLogStream, "Allocated readback page #{}, {} bytes", pageIndex, pageSize);
+            }
+            ReadbackPage& page = mReadbackPages[pageIndex];
+            page.used = alignedSize;
+            page.pendingCount = 1;
+            // small requests keep filling the page, a dedicated page is not worth sharing
+            if (page.size > alignedSize) {
+                mCurrentReadbackPage = pageIndex;
+            }
+            return { pageIndex, 0 };
+        }
+
+        void TaskGraph::RecordReadbacks(ICommandBuffer* commandBuffer) {
+            if (mRecordedReadbacks.empty()) {
+                return;
+            }
+            commandBuffer->BeginLabel({ .labelColor = LabelColor::BLUE,
+                .name = "Readbacks" });
+            auto& states = mResourceManager->GetResourceStateMap();
+            for (PendingReadback& readback : mRecordedReadbacks) {
+                Buffer dstBuffer = mReadbackPages[readback.page].buffer;
+                if (readback.srcBuffer) {
+                    Buffer srcBuffer = readback.srcBuffer->Internal();
+                    auto lastKnownLayout = states.mLastKnownBufferLayouts.find(srcBuffer);
+                    const BufferLayout layout = lastKnownLayout != states.mLastKnownBufferLayouts.end() ? lastKnownLayout->second : BufferLayout::Undefined;
+                    commandBuffer->BufferBarrier({
+                        .buffer = srcBuffer,
+                        .srcAccess = AccessConsts::READ_WRITE,
+                        .dstAccess = AccessConsts::TRANSFER_READ,
+                        .srcLayout = layout,
+                        .dstLayout = BufferLayout::TransferSrc,
+                    });
+                    commandBuffer->CopyBufferToBuffer({
+                        .srcBuffer = srcBuffer,
+                        .dstBuffer = dstBuffer,
+                        .srcOffset = readback.srcOffset + readback.srcBuffer->Region().offset,
+                        .dstOffset = readback.offset,
+                        .size = readback.size,
+                    });
+                    // the next frame's barriers expect the resource in its last known layout
+                    commandBuffer->BufferBarrier({
+                        .buffer = srcBuffer,
+                        .srcAccess = AccessConsts::TRANSFER_READ,
+                        .dstAccess = AccessConsts::READ_WRITE,
+                        .srcLayout = BufferLayout::TransferSrc,
+                        .dstLayout = layout == BufferLayout::Undefined ? BufferLayout::TransferSrc : layout,
+                    });
+                    if (layout == BufferLayout::Undefined) {
+                        states.mLastKnownBufferLayouts[srcBuffer] = BufferLayout::TransferSrc;
+                    }
+                } else {
+                    Image srcImage = readback.srcImage->Internal();
+                    auto lastKnownLayout = states.mLastKnownImageLayouts.find(srcImage);
+                    const ImageLayout layout = lastKnownLayout != states.mLastKnownImageLayouts.end() ? lastKnownLayout->second : ImageLayout::Undefined;
+                    commandBuffer->ImageBarrier({
+                        .image = srcImage,
+                        .srcAccess = AccessConsts::READ_WRITE,
+                        .dstAccess = AccessConsts::TRANSFER_READ,
+                        .srcLayout = layout,
+                        .dstLayout = ImageLayout::TransferSrc,
+                    });
+                    commandBuffer->CopyImageToBuffer({
+                        .image = srcImage,
+                        .imageSlice = readback.srcImageSlice,
+                        .imageExtent = readback.srcImageExtent,
+                        .buffer = dstBuffer,
+                        .bufferOffset = readback.offset,
+                        .rowPitch = readback.rowPitch,
+                    });
+                    commandBuffer->ImageBarrier({
+                        .image = srcImage,
+                        .srcAccess = AccessConsts::TRANSFER_READ,
+                        .dstAccess = AccessConsts::READ_WRITE,
+                        .srcLayout = ImageLayout::TransferSrc,
+                        .dstLayout = layout == ImageLayout::Undefined ? ImageLayout::TransferSrc : layout,
+                    });
+                    if (layout == ImageLayout::Undefined) {
+                        states.mLastKnownImageLayouts[srcImage] = ImageLayout::TransferSrc;
+                    }
+                }
+                commandBuffer->BufferBarrier({
+                    .buffer = dstBuffer,
+                    .srcAccess = AccessConsts::TRANSFER_WRITE,
+                    .dstAccess = AccessConsts::HOST_READ,
+                    .srcLayout = BufferLayout::TransferDst,
+                    .dstLayout = BufferLayout::TransferDst,
+                });
+                mQueuedReadbacks.push_back(eastl::move(readback));
+            }
+            mRecordedReadbacks.clear();
+            commandBuffer->EndLabel();
+        }
+
+        void TaskGraph::PollReadbacks() {
+            // readbacks are queued in frame order, so the first unfinished frame ends the poll
+            usize completed = 0;
+            u64 lastCompletedFrame = 0;
+            for (PendingReadback& readback : mQueuedReadbacks) {
+                if (readback.frame != lastCompletedFrame) {
+                    if (!mGpuFrameTimeline->WaitForValue(readback.frame, 0)) {
+                        break;
+                    }
+                    lastCompletedFrame = readback.frame;
+                }
+                ReadbackPage& page = mReadbackPages[readback.page];
+                const u8* data = mDevice->BufferHostAddress(page.buffer) + readback.offset;
+                readback.callback({ .frame = readback.frame, .data = { data, readback.size } });
+                --page.pendingCount;
+                ++completed;
+            }
+            mQueuedReadbacks.erase(mQueuedReadbacks.begin(), mQueuedReadbacks.begin() + completed);
+        }
+
+        void TaskGraph::ReleaseReadbackPages() {
+            mRecordedReadbacks.clear();
+            mQueuedReadbacks.clear();
+            for (ReadbackPage& page : mReadbackPages) {
+                mDevice->DestroyDeferred(page.buffer);
+            }
+            mReadbackPages.clear();
+            mCurrentReadbackPage = ~0U;
+        }
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,122 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "TaskMipGeneration.hpp"
+#include "TaskResourceManager.hpp"
+
+#include <EASTL/algorithm.h>
+#include <libassert/assert.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        // must match GenerateMips.slang
+        constexpr u32 MIPS_PER_DISPATCH = 4;
+        constexpr u32 MIP_GENERATION_TILE_SIZE = 16;
+        struct MipGenerationConstants {
+            u32 srcWidth;
+            u32 srcHeight;
+            u32 dstMipCount;
+            u32 padding;
+        };
+
+        MipGenerationTask::MipGenerationTask(TaskResourceManager* resourceManager, const TaskInfo& info, const TaskMipGenerationInfo& generationInfo)
+            : GenericTask(info), mResourceManager(resourceManager), mGenerationInfo(generationInfo) {
+            const TaskImageInfo& imageInfo = generationInfo.image->Info();
+            ASSERT(imageInfo.dimensions == ImageDimensions::e2D && imageInfo.sampleCount == RasterizationSamples::e1, "Mips can only be generated for single sampled 2D, array and cube images!");
+            ASSERT(bool(imageInfo.usage & ImageUsageFlagBits::UNORDERED_ACCESS), "Mip generation writes the image through unordered access views!");
+            ASSERT(generationInfo.pipeline, "Mip generation needs a pipeline!");
+            mMipViews.reserve(imageInfo.mipLevelCount);
+            for (u32 mip = 0; mip < imageInfo.mipLevelCount; ++mip) {
+                mMipViews.push_back(mResourceManager->CreateUnorderedAccessView({
+                    .image = generationInfo.image,
+                    .slice = {
+                        .baseMipLevel = mip,
+                        .levelCount = 1,
+                        .layerCount = imageInfo.arrayLayerCount,
+                    },
+                    .viewType = ImageViewType::e2DArray,
+                }));
+            }
+        }
+        MipGenerationTask::~MipGenerationTask() {
+            for (UnorderedAccessId& view : mMipViews) {
+                mResourceManager->ReleaseUnorderedAccessView(view);
+            }
+        }
+
+        void MipGenerationTask::SetupTask() {
+            UseImage({
+                .image = mGenerationInfo.image,
+                .access = AccessConsts::COMPUTE_SHADER_READ | AccessConsts::COMPUTE_SHADER_WRITE,
+            });
+        }
+        void MipGenerationTask::ExecuteTask(TaskCommandList& commandList) {
+            const TaskImageInfo& imageInfo = mGenerationInfo.image->Info();
+            RecordMipGeneration(commandList, mGenerationInfo.pipeline, mGenerationInfo.image->Internal(), imageInfo.size, imageInfo.arrayLayerCount, mMipViews);
+        }
+
+        void RecordMipGeneration(TaskCommandList& commandList, TaskComputePipeline pipeline, Image image,
+            const Extent3D& size, u32 arrayLayerCount, eastl::span<const UnorderedAccessId> mipViews) {
+            const u32 mipLevelCount = static_cast<u32>(mipViews.size());
+            if (mipLevelCount < 2) {
+                return;
+            }
+            commandList.SetComputePipeline(pipeline);
+            for (u32 srcMip = 0; srcMip + 1 < mipLevelCount; srcMip += MIPS_PER_DISPATCH) {
+                if (srcMip > 0) {
+                    // the source is the last mip written by the previous dispatch
+                    ImageMemoryBarrierInfo barrier = {
+                        .image = image,
+                        .srcAccess = AccessConsts::COMPUTE_SHADER_WRITE,
+                        .dstAccess = AccessConsts::COMPUTE_SHADER_READ,
+                        .srcLayout = ImageLayout::UnorderedAccess,
+                        .dstLayout = ImageLayout::UnorderedAccess,
+                    };
+                    barrier.imageSlice = {
+                        .baseMipLevel = srcMip,
+                        .levelCount = 1,
+                        .layerCount = arrayLayerCount,
+                    };
+                    commandList.Internal()->ImageBarrier(barrier);
+                }
+                const u32 dstMipCount = eastl::min(MIPS_PER_DISPATCH, mipLevelCount - 1 - srcMip);
+                // unused destinations alias the last mip, the shader never writes them
+                for (u32 slot = 0; slot <= MIPS_PER_DISPATCH; ++slot) {
+                    commandList.SetUnorderedAccessView({ .slot = slot, .view = mipViews[eastl::min(srcMip + slot, mipLevelCount - 1)] });
+                }
+                const MipGenerationConstants constants = {
+                    .srcWidth = eastl::max(size.width >> srcMip, 1U),
+                    .srcHeight = eastl::max(size.height >> srcMip, 1U),
+                    .dstMipCount = dstMipCount,
+                };
+                commandList.PushConstant(constants);
+                const u32 dstWidth = eastl::max(constants.srcWidth >> 1, 1U);
+                const u32 dstHeight = eastl::max(constants.srcHeight >> 1, 1U);
+                commandList.Dispatch({
+                    .x = (dstWidth + MIP_GENERATION_TILE_SIZE - 1) / MIP_GENERATION_TILE_SIZE,
+                    .y = (dstHeight + MIP_GENERATION_TILE_SIZE - 1) / MIP_GENERATION_TILE_SIZE,
+                    .z = arrayLayerCount,
+                });
+            }
+        }
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "Task.hpp"
+#include "TaskCommandList.hpp"
+#include <EASTL/span.h>
+#include <EASTL/vector.h>
+#include <ShockGraph/Core.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        class TaskResourceManager;
+
+        struct TaskMipGenerationInfo {
+            /**
+             * @brief Single sampled 2D, array or cube image with UNORDERED_ACCESS usage and a format that supports it.
+             */
+            TaskImage image = {};
+            /**
+             * @brief Compute pipeline of resources/Shaders/GenerateMips.slang, entry point generateMipsMain.
+             */
+            TaskComputePipeline pipeline = {};
+        };
+
+        /**
+         * @brief Box filters the whole mip chain of an image from mip 0, up to four mip levels per dispatch.
+         * The image is declared as one compute read-write dependency, the mips a dispatch reads from the previous one
+         * are synchronised inside of the task.
+         */
+        class MipGenerationTask final : public ComputeTask {
+        public:
+            SHOCKGRAPH_API MipGenerationTask(TaskResourceManager* resourceManager, const TaskInfo& info, const TaskMipGenerationInfo& generationInfo);
+            SHOCKGRAPH_API ~MipGenerationTask() override;
+
+            SHOCKGRAPH_API void SetupTask() override;
+            SHOCKGRAPH_API void ExecuteTask(TaskCommandList& commandList) override;
+
+        private:
+            TaskResourceManager* mResourceManager = nullptr;
+            TaskMipGenerationInfo mGenerationInfo = {};
+            // one single mip 2D array view per mip level
+            eastl::vector<UnorderedAccessId> mMipViews = {};
+        };
+
+        /**
+         * @brief Records the dispatches of a mip generation into an image already in the UnorderedAccess layout.
+         * mipViews holds one single mip 2D array view per mip level of the image.
+         */
+        SHOCKGRAPH_API void RecordMipGeneration(TaskCommandList& commandList, TaskComputePipeline pipeline, Image image,
+            const Extent3D& size, u32 arrayLayerCount, eastl::span<const UnorderedAccessId> mipViews);
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -22,6 +22,7 @@
 
 #include "TaskResourceManager.hpp"
 #include "IShaderReloadListener.hpp"
+#include "TaskGraph.hpp"
 
 #ifdef SHOCKGRAPH_USE_PYRO_PLATFORM
 #include <PyroPlatform/Window/IWindow.hpp>
@@ -30,9 +31,13 @@
 #include <PyroRHI/Api/Util.hpp>
 #include <PyroRHI/Context.hpp>
 
+#include <EASTL/algorithm.h>
 #include <EASTL/shared_ptr.h>
+#include <EASTL/sort.h>
 #include <PyroCommon/Logger.hpp>
 #include <PyroRHI/Common/AtomicMap.hpp>
+#include <chrono>
+#include <cstring>
 #include <libassert/assert.hpp>
 
 namespace PyroshockStudios {
@@ -65,9 +70,14 @@ namespace PyroshockStudios {
         }
 
         TaskResourceManager::TaskResourceManager(const TaskResourceManagerInfo& info)
-            : mDevice(info.device), mRHI(info.rhi), mFramesInFlight(info.framesInFlight), mShaderReloadListener(new ShaderReloadListener(this)) {
+            : mbDeduplicateInitialData(info.bDeduplicateInitialData), mBufferHeapSize(info.bufferHeapSize), mMaxSuballocationSize(info.maxSuballocationSize),
+              mStagingPageSize(info.stagingPageSize), mMaxStagingPages(info.maxStagingPages), mUploadBudgetPerFrame(info.uploadBudgetPerFrame),
+              mStagingCopyPool(info.stagingCopyThreads),
+              mDevice(info.device), mRHI(info.rhi),
+              mFramesInFlight(info.framesInFlight), mShaderReloadListener(new ShaderReloadListener(this)) {
             ASSERT(mRHI, "RHI was not set!");
             ASSERT(mDevice, "Device was not set!");
+            ASSERT(mBufferHeapSize == 0 || (mMaxSuballocationSize != 0 && mMaxSuballocationSize <= mBufferHeapSize), "Suballocations must fit into a buffer heap!");
 
             {
                 std::lock_guard l(GetResourceStates().GetLock());
@@ -78,14 +88,175 @@ namespace PyroshockStudios {
         }
 
         TaskResourceManager::~TaskResourceManager() {
+            mMipGenerationPipeline = {};
+            ClearDeduplicationCache();
             if (mResources.Size() != mTombstones.Size()) {
                 Logger::Fatal(mLogStream, "Not all resources have been released before task resource manager destruction! "
                                           "All resources must be destroyed before the resource manager!");
             }
+            for (StagingPage& page : mStagingPages) {
+                mDevice->DestroyDeferred(page.buffer);
+            }
+            for (BufferHeap& heap : mBufferHeaps) {
+                GetResourceStateMap().mLastKnownBufferLayouts.erase(heap.buffer);
+                mDevice->DestroyDeferred(heap.buffer);
+            }
             delete mShaderReloadListener;
         }
 
-        TaskBuffer TaskResourceManager::CreatePersistentBuffer(const TaskBufferInfo& info, eastl::span<const u8> initialData) {
+        // device memory of every mip level and array layer of an image, rows tightly packed
+        static usize ImageResourceSize(const TaskImageInfo& info) {
+            const RHIUtil::FormatBlockInfo blockInfo = RHIUtil::GetFormatBlockInfo(info.format);
+            usize size = 0;
+            for (u32 mip = 0; mip < info.mipLevelCount; ++mip) {
+                const u32 blocksX = (eastl::max(info.size.width >> mip, 1U) + blockInfo.blockWidth - 1) / blockInfo.blockWidth;
+                const u32 blocksY = (eastl::max(info.size.height >> mip, 1U) + blockInfo.blockHeight - 1) / blockInfo.blockHeight;
+                size += static_cast<usize>(blocksX) * blockInfo.bytesPerBlock * blocksY * eastl::max(info.size.depth >> mip, 1U);
+            }
+            return size * info.arrayLayerCount;
+        }
+
+        TaskBuffer TaskResourceManager::CreatePersistentBuffer(const TaskBufferInfo& info, eastl::span<const u8> initialData, TaskUploadPriority priority) {
+            // CPU writable modes would let one owner overwrite the data of every other
+            const bool bDeduplicate = mbDeduplicateInitialData && !initialData.empty() && info.mode == TaskBufferMode::Default &&
+                                      !bool(info.usage & (BufferUsageFlagBits::UNORDERED_ACCESS | BufferUsageFlagBits::TRANSFER_DST));
+            const eastl::span<const u8> sharedData = initialData.first(eastl::min(initialData.size(), info.size));
+            DeduplicationKey key = {};
+            if (bDeduplicate) {
+                key = MakeDeduplicationKey(info, sharedData);
+                std::lock_guard l(mDeduplicationLock);
+                auto it = mDeduplicatedBuffers.find(key);
+                if (it != mDeduplicatedBuffers.end() && MatchesDeduplicatedBuffer(it->second, info, sharedData)) {
+                    ++mDeduplicationStats.hits;
+                    mDeduplicationStats.savedBytes += info.size;
+                    return it->second.buffer;
+                }
+                ++mDeduplicationStats.misses;
+            }
+            StagingUploadPair uploadPair{};
+            StagingAllocation staging = {};
+            if (!initialData.empty()) {
+                staging = AllocateStaging(info.size, info.name);
+                uploadPair.srcBuffer = staging.buffer;
+                uploadPair.stagingPage = staging.page;
+                uploadPair.size = info.size;
+                uploadPair.priority = priority;
+            }
+            eastl::vector<StagingCopyRegion> copies = {};
+            TaskBuffer retBuffer = CreateBufferResource(info, initialData, staging, 0, uploadPair, copies);
+            mStagingCopyPool.Copy(copies);
+            if (!uploadPair.uploads.empty()) {
+                mPendingStagingUploads.EmplaceBack(eastl::move(uploadPair));
+            }
+            if (bDeduplicate) {
+                // another thread may have created the same buffer meanwhile, ours is dropped along with its upload.
+                // A different buffer under the same key keeps its entry and ours is simply not shared
+                std::lock_guard l(mDeduplicationLock);
+                auto it = mDeduplicatedBuffers.find(key);
+                if (it == mDeduplicatedBuffers.end()) {
+                    mDeduplicatedBuffers.emplace(key, DeduplicatedBuffer{ retBuffer, eastl::vector<u8>(sharedData.begin(), sharedData.end()) });
+                } else if (MatchesDeduplicatedBuffer(it->second, info, sharedData)) {
+                    return it->second.buffer;
+                }
+            }
+            return retBuffer;
+        }
+
+        TaskImage TaskResourceManager::CreatePersistentImage(const TaskImageInfo& info, eastl::span<const u8> initialData, TaskUploadPriority priority,
+            eastl::span<const TaskImageSubresourceData> layout) {
+            const bool bDeduplicate = mbDeduplicateInitialData && !initialData.empty() &&
+                                      !bool(info.usage & (ImageUsageFlagBits::UNORDERED_ACCESS | ImageUsageFlagBits::RENDER_TARGET | ImageUsageFlagBits::TRANSFER_DST));
+            DeduplicationKey key = {};
+            if (bDeduplicate) {
+                key = MakeDeduplicationKey(info, initialData, layout);
+                std::lock_guard l(mDeduplicationLock);
+                auto it = mDeduplicatedImages.find(key);
+                if (it != mDeduplicatedImages.end() && MatchesDeduplicatedImage(it->second, info, initialData, layout)) {
+                    ++mDeduplicationStats.hits;
+                    // the initial data may carry container headers or row padding, count the memory the image occupies instead
+                    mDeduplicationStats.savedBytes += ImageResourceSize(info);
+                    return it->second.image;
+                }
+                ++mDeduplicationStats.misses;
+            }
+            StagingUploadPair uploadPair{};
+            StagingAllocation staging = {};
+            eastl::vector<ImageUploadRegion> regions = {};
+            if (!initialData.empty()) {
+                const DeviceSize stagingSize = PlanImageUpload(info, initialData, layout, regions);
+                staging = AllocateStaging(stagingSize, info.name);
+                uploadPair.srcBuffer = staging.buffer;
+                uploadPair.stagingPage = staging.page;
+                uploadPair.size = stagingSize;
+                uploadPair.priority = priority;
+            }
+            eastl::vector<StagingCopyRegion> copies = {};
+            TaskImage retImage = CreateImageResource(info, initialData, regions, staging, 0, uploadPair, copies);
+            mStagingCopyPool.Copy(copies);
+            if (!uploadPair.uploads.empty()) {
+                mPendingStagingUploads.EmplaceBack(eastl::move(uploadPair));
+            }
+            if (bDeduplicate) {
+                std::lock_guard l(mDeduplicationLock);
+                auto it = mDeduplicatedImages.find(key);
+                if (it == mDeduplicatedImages.end()) {
+                    mDeduplicatedImages.emplace(key, DeduplicatedImage{ retImage, eastl::vector<u8>(initialData.begin(), initialData.end()),
+                                                          eastl::vector<TaskImageSubresourceData>(layout.begin(), layout.end()) });
+                } else if (MatchesDeduplicatedImage(it->second, info, initialData, layout)) {
+                    return it->second.image;
+                }
+            }
+            return retImage;
+        }
+
+        void TaskResourceManager::CreatePersistentResources(const TaskResourceBatchInfo& info, eastl::span<TaskBuffer> outBuffers, eastl::span<TaskImage> outImages) {
+            ASSERT(outBuffers.size() >= info.buffers.size() && outImages.size() >= info.images.size(), "Not enough room for the created resources!");
+            // copy offsets into images must be a multiple of the texel block size, 512 covers every format
+            constexpr DeviceSize RESOURCE_ALIGNMENT = 512;
+
+            // lay out the initial data of every resource in one staging range first
+            eastl::vector<DeviceSize> bufferOffsets(info.buffers.size(), 0);
+            eastl::vector<DeviceSize> imageOffsets(info.images.size(), 0);
+            eastl::vector<eastl::vector<ImageUploadRegion>> imageRegions(info.images.size());
+            DeviceSize stagingSize = 0;
+            for (usize i = 0; i < info.buffers.size(); ++i) {
+                if (!info.buffers[i].initialData.empty()) {
+                    bufferOffsets[i] = stagingSize;
+                    stagingSize = PYRO_ALIGN(stagingSize + info.buffers[i].info.size, RESOURCE_ALIGNMENT);
+                }
+            }
+            for (usize i = 0; i < info.images.size(); ++i) {
+                const TaskImageCreateInfo& image = info.images[i];
+                if (!image.initialData.empty()) {
+                    imageOffsets[i] = stagingSize;
+                    stagingSize = PYRO_ALIGN(stagingSize + PlanImageUpload(image.info, image.initialData, image.layout, imageRegions[i]), RESOURCE_ALIGNMENT);
+                }
+            }
+
+            StagingUploadPair uploadPair{};
+            StagingAllocation staging = {};
+            if (stagingSize > 0) {
+                staging = AllocateStaging(stagingSize, "Resource Batch");
+                uploadPair.srcBuffer = staging.buffer;
+                uploadPair.stagingPage = staging.page;
+                uploadPair.size = stagingSize;
+                uploadPair.priority = info.priority;
+            }
+            eastl::vector<StagingCopyRegion> copies = {};
+            for (usize i = 0; i < info.buffers.size(); ++i) {
+                outBuffers[i] = CreateBufferResource(info.buffers[i].info, info.buffers[i].initialData, staging, bufferOffsets[i], uploadPair, copies);
+            }
+            for (usize i = 0; i < info.images.size(); ++i) {
+                outImages[i] = CreateImageResource(info.images[i].info, info.images[i].initialData, imageRegions[i], staging, imageOffsets[i], uploadPair, copies);
+            }
+            mStagingCopyPool.Copy(copies);
+            if (!uploadPair.uploads.empty()) {
+                mPendingStagingUploads.EmplaceBack(eastl::move(uploadPair));
+            }
+        }
+
+        TaskBuffer TaskResourceManager::CreateBufferResource(const TaskBufferInfo& info, eastl::span<const u8> initialData, const StagingAllocation& staging,
+            usize stagingOffset, StagingUploadPair& uploadPair, eastl::vector<StagingCopyRegion>& copies) {
             ASSERT(!bool(info.usage & BufferUsageFlagBits::UNIFORM_BUFFER) || info.size <= Limits::MAX_UNIFORM_BUFFER_SIZE, "Ubos must be at most UINT16 bytes in size!");
             BufferUsageFlags extraRequiredFlags = {};
             eastl::vector<Buffer> buffersInFlight{};
@@ -97,18 +268,15 @@ namespace PyroshockStudios {
             if (info.mode == TaskBufferMode::Dynamic || bExposeFlightBuffers) {
                 buffersInFlight.resize(mFramesInFlight);
                 for (u32 i = 0; i < mFramesInFlight; ++i) {
-                    buffersInFlight[i] = mDevice->CreateBuffer({
-                        .size = info.size,
-                        .usage = (bExposeFlightBuffers ? (info.usage) : (BufferUsageFlagBits::TRANSFER_SRC)) | extraRequiredFlags,
-                        .initialLayout = info.mode == TaskBufferMode::Readback ? BufferLayout::TransferDst : BufferLayout::TransferSrc,
-                        .allocationDomain = info.mode == TaskBufferMode::Readback ? MemoryAllocationDomain::HostReadback : MemoryAllocationDomain::HostRandomWrite,
-                        .name = info.name + " (In Flight #" + eastl::to_string(i) + ")",
-                    });
+                    buffersInFlight[i] = CreateInFlightBuffer(info, i, extraRequiredFlags);
                 }
             }
+            const BufferSuballocation suballocation = SuballocateBuffer(info);
             if (info.mode == TaskBufferMode::Readback || info.mode == TaskBufferMode::HostDynamic) {
                 // No need to duplicate the buffers, can read write anyway
                 buffer = buffersInFlight[0];
+            } else if (suballocation.heap != ~0U) {
+                buffer = suballocation.buffer;
             } else if (info.mode == TaskBufferMode::Default) {
                 buffer = mDevice->CreateBuffer({
                     .size = info.size,
@@ -140,40 +308,120 @@ namespace PyroshockStudios {
             if (!initialData.empty()) {
                 ASSERT(info.mode == TaskBufferMode::Default, "Only buffers with Default mode can be initialised with data!");
                 ASSERT(initialData.size_bytes() >= info.size, "Initial data is too small in size!");
-                Buffer staging = mDevice->CreateBuffer({
-                    .size = info.size,
-                    .usage = BufferUsageFlagBits::TRANSFER_SRC,
-                    .initialLayout = BufferLayout::TransferSrc,
-                    .allocationDomain = MemoryAllocationDomain::HostStaging,
-                    .name = info.name + " (Staging Buffer)",
+                copies.push_back({
+                    .src = initialData.data(),
+                    .dst = staging.hostAddress + stagingOffset,
+                    .srcRowPitch = info.size,
+                    .dstRowPitch = info.size,
+                    .rowSize = info.size,
                 });
-                memcpy(mDevice->BufferHostAddress(staging), initialData.data(), info.size);
-
-                StagingUploadPair uploadPair{};
-                uploadPair.srcBuffer = staging;
                 uploadPair.uploads.push_back({
+                    .srcOffset = staging.offset + stagingOffset,
                     .dstBuffer = buffer,
+                    .dstBufferOffset = suballocation.offset,
+                    .dstBufferSize = info.size,
                     .dstBufferLayout = BufferLayout::ReadOnly,
                 });
-                mPendingStagingUploads.EmplaceBack(eastl::move(uploadPair));
             }
 
             if (info.mode == TaskBufferMode::Host) {
-                buffersInFlight.resize(mFramesInFlight, buffer);
+                // a single entry is shared by every frame, so it does not depend on the frames in flight
+                buffersInFlight.push_back(buffer);
             }
             TaskBuffer retBuffer = TaskBuffer::Create(this, info, eastl::move(buffer), eastl::move(buffersInFlight));
+            retBuffer->mHeap = suballocation.heap;
+            retBuffer->mHeapOffset = suballocation.offset;
+            if (!initialData.empty()) {
+                retBuffer->mbResident = false;
+                uploadPair.resident.push_back(&retBuffer->mbResident);
+            }
             if (info.mode == TaskBufferMode::Dynamic || info.mode == TaskBufferMode::HostDynamic || info.mode == TaskBufferMode::Readback) {
                 mDynamicBuffers.EmplaceBack(retBuffer.Get());
             }
             return retBuffer;
         }
 
-        TaskImage TaskResourceManager::CreatePersistentImage(const TaskImageInfo& info, eastl::span<const u8> initialData) {
+        DeviceSize TaskResourceManager::PlanImageUpload(const TaskImageInfo& info, eastl::span<const u8> initialData, eastl::span<const TaskImageSubresourceData> layout,
+            eastl::vector<ImageUploadRegion>& regions) const {
+            const u32 rowAlignment = mDevice->Properties().bufferImageRowAlignment;
+            // copy offsets into images must be a multiple of the texel block size, 512 covers every format
+            constexpr DeviceSize REGION_ALIGNMENT = 512;
+
+            const RHIUtil::FormatBlockInfo blockInfo = RHIUtil::GetFormatBlockInfo(info.format);
+
+            eastl::vector<TaskImageSubresourceData> defaultLayout = {};
+            if (layout.empty()) {
+                usize offset = 0;
+                const u32 uploadedMipCount = info.bGenerateMips ? 1 : info.mipLevelCount;
+                for (u32 layer = 0; layer < info.arrayLayerCount; ++layer) {
+                    for (u32 mip = 0; mip < uploadedMipCount; ++mip) {
+                        defaultLayout.push_back({ .mipLevel = mip, .arrayLayer = layer, .offset = offset });
+                        const u32 blocksX = (eastl::max(info.size.width >> mip, 1U) + blockInfo.blockWidth - 1) / blockInfo.blockWidth;
+                        const u32 blocksY = (eastl::max(info.size.height >> mip, 1U) + blockInfo.blockHeight - 1) / blockInfo.blockHeight;
+                        offset += static_cast<usize>(blocksX) * blockInfo.bytesPerBlock * blocksY * eastl::max(info.size.depth >> mip, 1U);
+                    }
+                }
+                layout = defaultLayout;
+            }
+
+            // every region gets its own aligned rows inside a single staging allocation
+            regions.clear();
+            regions.reserve(layout.size());
+            DeviceSize stagingSize = 0;
+            for (const TaskImageSubresourceData& subresource : layout) {
+                ASSERT(subresource.mipLevel < info.mipLevelCount && subresource.arrayLayer < info.arrayLayerCount, "Subresource is out of range!");
+                ImageUploadRegion region = {};
+                region.subresource = subresource;
+                region.extent = {
+                    eastl::max(info.size.width >> subresource.mipLevel, 1U),
+                    eastl::max(info.size.height >> subresource.mipLevel, 1U),
+                    eastl::max(info.size.depth >> subresource.mipLevel, 1U),
+                };
+                const u32 blocksX = (region.extent.width + blockInfo.blockWidth - 1) / blockInfo.blockWidth;
+                region.blocksY = (region.extent.height + blockInfo.blockHeight - 1) / blockInfo.blockHeight;
+                region.tightRowPitch = blocksX * blockInfo.bytesPerBlock;
+                region.srcRowPitch = subresource.rowPitch == 0 ? region.tightRowPitch : subresource.rowPitch;
+                region.alignedRowPitch = PYRO_ALIGN(region.tightRowPitch, rowAlignment);
+                region.stagingOffset = stagingSize;
+
+                const DeviceSize srcSize = static_cast<DeviceSize>(region.srcRowPitch) * (region.blocksY * region.extent.depth - 1) + region.tightRowPitch;
+                ASSERT(subresource.offset + srcSize <= initialData.size_bytes(), "Initial data is too small!");
+                stagingSize = PYRO_ALIGN(stagingSize + static_cast<DeviceSize>(region.alignedRowPitch) * region.blocksY * region.extent.depth, REGION_ALIGNMENT);
+                regions.push_back(region);
+            }
+            return stagingSize;
+        }
+
+        // generated mips are box filtered and written through float4 unordered access views, only float and unorm colour formats
+        // that every backend can store to qualify. Depth, integer, sRGB and block compressed formats are left out.
+        static bool SupportsMipGeneration(Format format) {
+            switch (format) {
+            case Format::R8Unorm:
+            case Format::RG8Unorm:
+            case Format::RGBA8Unorm:
+            case Format::RGBA16Sfloat:
+            case Format::RG32Sfloat:
+            case Format::RGBA32Sfloat:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        TaskImage TaskResourceManager::CreateImageResource(const TaskImageInfo& info, eastl::span<const u8> initialData, eastl::span<const ImageUploadRegion> regions,
+            const StagingAllocation& staging, usize stagingOffset, StagingUploadPair& uploadPair, eastl::vector<StagingCopyRegion>& copies) {
             ImageUsageFlags extraRequiredFlags = {};
 
             if (!initialData.empty()) {
                 extraRequiredFlags |= ImageUsageFlagBits::TRANSFER_DST;
             }
+            const bool bGenerateMips = info.bGenerateMips && info.mipLevelCount > 1;
+            if (bGenerateMips) {
+                ASSERT(info.dimensions == ImageDimensions::e2D && info.sampleCount == RasterizationSamples::e1, "Mips can only be generated for single sampled 2D, array and cube images!");
+                ASSERT(mMipGenerationPipeline, "Call SetMipGenerationPipeline() before creating images with bGenerateMips!");
+                ASSERT(SupportsMipGeneration(info.format), "Mips can only be generated for float and unorm colour formats with storage support! Upload every mip level instead.");
+                extraRequiredFlags |= ImageUsageFlagBits::UNORDERED_ACCESS;
+            }
             Image image = mDevice->CreateImage({
                 .flags = info.flags,
                 .dimensions = info.dimensions,
@@ -185,53 +433,33 @@ namespace PyroshockStudios {
                 .usage = info.usage | extraRequiredFlags,
                 .name = info.name,
             });
-            // FIXME, texture arrays/mipmaps!
-            if (!initialData.empty()) {
-                const u32 rowAlignment = mDevice->Properties().bufferImageRowAlignment;
-
-                const RHIUtil::FormatBlockInfo blockInfo = RHIUtil::GetFormatBlockInfo(info.format);
-
-                const u32 blocksX = (info.size.width + blockInfo.blockWidth - 1) / blockInfo.blockWidth;
-                const u32 blocksY = (info.size.height + blockInfo.blockHeight - 1) / blockInfo.blockHeight;
-
-                const u32 tightRowPitch = blocksX * blockInfo.bytesPerBlock;
-                const u32 alignedRowPitch = PYRO_ALIGN(tightRowPitch, rowAlignment);
-                const DeviceSize stagingSize = alignedRowPitch * blocksY * info.size.depth;
-
-                const DeviceSize tightSize = tightRowPitch * blocksY * info.size.depth;
-                ASSERT(initialData.size_bytes() >= tightSize, "Initial data is too small!");
-
-                Buffer staging = mDevice->CreateBuffer({
-                    .size = stagingSize, // Use calculated staging size, not ImageRequirements (which might include mips)
-                    .usage = BufferUsageFlagBits::TRANSFER_SRC,
-                    .initialLayout = BufferLayout::TransferSrc,
-                    .allocationDomain = MemoryAllocationDomain::HostStaging,
-                    .name = info.name + " (Staging Buffer)",
+            for (const ImageUploadRegion& region : regions) {
+                copies.push_back({
+                    .src = initialData.data() + region.subresource.offset,
+                    .dst = staging.hostAddress + stagingOffset + region.stagingOffset,
+                    .srcRowPitch = region.srcRowPitch,
+                    .dstRowPitch = region.alignedRowPitch,
+                    .rowSize = region.tightRowPitch,
+                    .rowCount = static_cast<usize>(region.blocksY) * region.extent.depth,
                 });
-
-                u8* dstPtr = mDevice->BufferHostAddress(staging);
-                const u8* srcPtr = initialData.data();
-
-                RHIUtil::CopyAlignedTextureData(srcPtr, dstPtr, tightRowPitch, blocksY, info.size.depth, alignedRowPitch);
-
-                StagingUploadPair uploadPair{};
-                uploadPair.srcBuffer = staging;
-
-                // FIXME: Only uploading Mip 0 for now.
-                // To support all mips, you must loop mips, recalculate blocksX/Y per mip,
-                // and offset srcPtr and dstPtr accordingly.
-                uploadPair.uploads.push_back({ .dstImage = image,
+                uploadPair.uploads.push_back({ .srcOffset = staging.offset + stagingOffset + region.stagingOffset,
+                    .dstImage = image,
                     .dstImageLayout = ImageLayout::ReadOnly,
                     .dstImageSlice = {
-                        .mipLevel = 0,
-                        .baseArrayLayer = 0,
-                        .layerCount = info.arrayLayerCount,
+                        .mipLevel = region.subresource.mipLevel,
+                        .baseArrayLayer = region.subresource.arrayLayer,
+                        .layerCount = 1,
                     },
-                    .rowPitch = alignedRowPitch });
-
-                mPendingStagingUploads.EmplaceBack(eastl::move(uploadPair));
+                    .dstImageExtent = region.extent,
+                    .rowPitch = region.alignedRowPitch,
+                    .bGenerateMips = bGenerateMips });
             }
-            return TaskImage::Create(this, info, eastl::move(image));
+            TaskImage retImage = TaskImage::Create(this, info, eastl::move(image));
+            if (!regions.empty()) {
+                retImage->mbResident = false;
+                uploadPair.resident.push_back(&retImage->mbResident);
+            }
+            return retImage;
         }
 
         TaskBlas TaskResourceManager::CreatePersistentBlas(const TaskBlasInfo& info) {
@@ -253,6 +481,8 @@ namespace PyroshockStudios {
         }
 
         ShaderResourceId TaskResourceManager::DefaultShaderResourceView(TaskImage image) {
+            ASSERT(image->mVersioningGraphs.load() == 0, "Cannot create views of a resource renamed by a built task graph, create them before Build() to opt it out of resource versioning!");
+            image->mbHasExternalViews = true;
             auto& imageInfo = mDevice->GetImageInfo(image->Internal());
             ImageResourceInfo resourceInfo{
                 .image = image->Internal(),
@@ -281,13 +511,11 @@ namespace PyroshockStudios {
         }
 
         ShaderResourceId TaskResourceManager::DefaultShaderResourceView(TaskBuffer buffer) {
-            auto& bufferInfo = mDevice->GetBufferInfo(buffer->Internal());
+            ASSERT(buffer->mVersioningGraphs.load() == 0, "Cannot create views of a resource renamed by a built task graph, create them before Build() to opt it out of resource versioning!");
+            buffer->mbHasExternalViews = true;
             BufferResourceInfo resourceInfo{
                 .buffer = buffer->Internal(),
-                .region = {
-                    .offset = 0,
-                    .size = bufferInfo.size,
-                },
+                .region = buffer->Region(),
             };
             return mDevice->CreateShaderResource(resourceInfo);
         }
@@ -346,14 +574,30 @@ namespace PyroshockStudios {
         }
 
 
+        // views of a suballocated buffer are relative to its range of the heap
+        static BufferRegion ViewRegion(const TaskBuffer_& buffer, const BufferRegion& region) {
+            if (!buffer.IsSuballocated()) {
+                return region;
+            }
+            const BufferRegion bufferRegion = buffer.Region();
+            return {
+                .offset = bufferRegion.offset + region.offset,
+                .size = region.size != 0 ? region.size : bufferRegion.size - region.offset,
+            };
+        }
+
         ShaderResourceId TaskResourceManager::CreateShaderResourceView(const TaskBufferResourceInfo& info) {
+            ASSERT(info.buffer->mVersioningGraphs.load() == 0, "Cannot create views of a resource renamed by a built task graph, create them before Build() to opt it out of resource versioning!");
+            info.buffer->mbHasExternalViews = true;
             return mDevice->CreateShaderResource(BufferResourceInfo{
                 .buffer = info.buffer->Internal(),
-                .region = info.region,
+                .region = ViewRegion(*info.buffer, info.region),
             });
         }
 
         ShaderResourceId TaskResourceManager::CreateShaderResourceView(const TaskImageResourceInfo& info) {
+            ASSERT(info.image->mVersioningGraphs.load() == 0, "Cannot create views of a resource renamed by a built task graph, create them before Build() to opt it out of resource versioning!");
+            info.image->mbHasExternalViews = true;
             return mDevice->CreateShaderResource(ImageResourceInfo{
                 .image = info.image->Internal(),
                 .slice = info.slice,
@@ -363,13 +607,17 @@ namespace PyroshockStudios {
         }
 
         UnorderedAccessId TaskResourceManager::CreateUnorderedAccessView(const TaskBufferResourceInfo& info) {
+            ASSERT(info.buffer->mVersioningGraphs.load() == 0, "Cannot create views of a resource renamed by a built task graph, create them before Build() to opt it out of resource versioning!");
+            info.buffer->mbHasExternalViews = true;
             return mDevice->CreateUnorderedAccess(BufferResourceInfo{
                 .buffer = info.buffer->Internal(),
-                .region = info.region,
+                .region = ViewRegion(*info.buffer, info.region),
             });
         }
 
         UnorderedAccessId TaskResourceManager::CreateUnorderedAccessView(const TaskImageResourceInfo& info) {
+            ASSERT(info.image->mVersioningGraphs.load() == 0, "Cannot create views of a resource renamed by a built task graph, create them before Build() to opt it out of resource versioning!");
+            info.image->mbHasExternalViews = true;
             return mDevice->CreateUnorderedAccess(ImageResourceInfo{
                 .image = info.image->Internal(),
                 .slice = info.slice,
@@ -480,8 +728,464 @@ namespace PyroshockStudios {
             return TaskSwapChain::Create(this, info, eastl::move(swapChain));
         }
 
+        Buffer TaskResourceManager::CreateInFlightBuffer(const TaskBufferInfo& info, u32 index, BufferUsageFlags extraRequiredFlags) {
+            bool bExposeFlightBuffers = info.mode == TaskBufferMode::HostDynamic || info.mode == TaskBufferMode::Readback;
+            return mDevice->CreateBuffer({
+                .size = info.size,
+                .usage = (bExposeFlightBuffers ? (info.usage) : (BufferUsageFlagBits::TRANSFER_SRC)) | extraRequiredFlags,
+                .initialLayout = info.mode == TaskBufferMode::Readback ? BufferLayout::TransferDst : BufferLayout::TransferSrc,
+                .allocationDomain = info.mode == TaskBufferMode::Readback ? MemoryAllocationDomain::HostReadback : MemoryAllocationDomain::HostRandomWrite,
+                .name = info.name + " (In Flight #" + eastl::to_string(index) + ")",
+            });
+        }
+
         void TaskResourceManager::SetFramesInFlight(u32 newFramesInFlight) {
-            ASSERT(false, "Not implemented");
+            ASSERT(newFramesInFlight > 0, "At least one frame must be in flight!");
+            if (newFramesInFlight == mFramesInFlight) {
+                return;
+            }
+            std::lock_guard graphsLock(mTaskGraphs.GetLock());
+            auto& graphs = mTaskGraphs.UnderlyingVector();
+            // graphs building in the background read the frame count, they have to finish first
+            for (TaskGraph* graph : graphs) {
+                graph->WaitForPendingBuild();
+            }
+            // every in flight copy may still be read by the GPU
+            mDevice->WaitIdle();
+
+            auto& states = GetResourceStateMap();
+            {
+                std::lock_guard buffersLock(mDynamicBuffers.GetLock());
+                for (TaskBuffer_* buffer : mDynamicBuffers.UnderlyingVector()) {
+                    const u32 oldFramesInFlight = static_cast<u32>(buffer->mInFlightBuffers.size());
+                    Buffer current = buffer->InternalInFlightBuffer(buffer->mCurrentBufferInFlight);
+                    if (current != buffer->mInFlightBuffers[0]) {
+                        // the copy index restarts at 0, which has to hold the latest contents
+                        memcpy(mDevice->BufferHostAddress(buffer->mInFlightBuffers[0]), mDevice->BufferHostAddress(current), buffer->Info().size);
+                        current = buffer->mInFlightBuffers[0];
+                    }
+                    for (u32 i = newFramesInFlight; i < oldFramesInFlight; ++i) {
+                        states.mLastKnownBufferLayouts.erase(buffer->mInFlightBuffers[i]);
+                        mDevice->DestroyDeferred(buffer->mInFlightBuffers[i]);
+                    }
+                    buffer->mInFlightBuffers.resize(newFramesInFlight);
+                    for (u32 i = oldFramesInFlight; i < newFramesInFlight; ++i) {
+                        // new copies start with the latest contents, so no frame reads stale data
+                        buffer->mInFlightBuffers[i] = CreateInFlightBuffer(buffer->Info(), i);
+                        memcpy(mDevice->BufferHostAddress(buffer->mInFlightBuffers[i]), mDevice->BufferHostAddress(current), buffer->Info().size);
+                    }
+                    buffer->mCurrentBufferInFlight = 0;
+                    if (buffer->Info().mode != TaskBufferMode::Dynamic) {
+                        buffer->mBuffer = buffer->mInFlightBuffers[0];
+                    }
+                }
+            }
+            mFramesInFlight = newFramesInFlight;
+
+            for (TaskGraph* graph : graphs) {
+                graph->ResizeFramesInFlight(newFramesInFlight);
+            }
+            Logger::Trace(mLogStream, "Resized frames in flight to {}, {} dynamic buffers, {} task graphs", newFramesInFlight, mDynamicBuffers.Size(), graphs.size());
+        }
+
+        TaskStagingStats TaskResourceManager::GetStagingStats() {
+            std::lock_guard l(mStagingLock);
+            TaskStagingStats stats = mStagingStats;
+            stats.pageCount = static_cast<u32>(mStagingPages.size());
+            stats.pageCapacity = mStagingPages.size() * mStagingPageSize;
+            stats.usedBytes = 0;
+            for (const StagingPage& page : mStagingPages) {
+                stats.usedBytes += page.used;
+            }
+            std::lock_guard uploadsLock(mPendingStagingUploads.GetLock());
+            for (const StagingUploadPair& uploadPair : mPendingStagingUploads.UnderlyingVector()) {
+                ++stats.pendingUploads;
+                stats.pendingUploadBytes += uploadPair.size;
+            }
+            return stats;
+        }
+
+        void TaskResourceManager::MakeResident(TaskBuffer buffer) {
+            PrioritizeUpload(&buffer->mbResident);
+        }
+        void TaskResourceManager::MakeResident(TaskImage image) {
+            PrioritizeUpload(&image->mbResident);
+        }
+        void TaskResourceManager::PrioritizeUpload(std::atomic<bool>* resident) {
+            std::lock_guard l(mPendingStagingUploads.GetLock());
+            for (StagingUploadPair& uploadPair : mPendingStagingUploads.UnderlyingVector()) {
+                if (eastl::find(uploadPair.resident.begin(), uploadPair.resident.end(), resident) != uploadPair.resident.end()) {
+                    uploadPair.priority = TaskUploadPriority::Immediate;
+                }
+            }
+        }
+        void TaskResourceManager::SetUploadBudget(usize bytesPerFrame) {
+            mUploadBudgetPerFrame = bytesPerFrame;
+        }
+        void TaskResourceManager::SetMipGenerationPipeline(TaskComputePipeline pipeline) {
+            mMipGenerationPipeline = eastl::move(pipeline);
+        }
+
+        TaskDeduplicationStats TaskResourceManager::GetDeduplicationStats() {
+            std::lock_guard l(mDeduplicationLock);
+            TaskDeduplicationStats stats = mDeduplicationStats;
+            stats.entries = static_cast<u32>(mDeduplicatedBuffers.size() + mDeduplicatedImages.size());
+            return stats;
+        }
+        void TaskResourceManager::ClearDeduplicationCache() {
+            // the entries are dropped outside of the lock, releasing a resource takes other locks of the manager
+            eastl::hash_map<DeduplicationKey, DeduplicatedBuffer, DeduplicationKeyHash> buffers = {};
+            eastl::hash_map<DeduplicationKey, DeduplicatedImage, DeduplicationKeyHash> images = {};
+            {
+                std::lock_guard l(mDeduplicationLock);
+                buffers.swap(mDeduplicatedBuffers);
+                images.swap(mDeduplicatedImages);
+            }
+        }
+
+        // four lane multiply-rotate hash in the style of xxHash64, the lanes are folded twice for a 128 bit content key
+        constexpr u64 HASH_PRIME_0 = 0x9E3779B185EBCA87ULL;
+        constexpr u64 HASH_PRIME_1 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr u64 HASH_PRIME_2 = 0x165667B19E3779F9ULL;
+        static constexpr u64 RotateLeft(u64 value, u32 bits) {
+            return (value << bits) | (value >> (64 - bits));
+        }
+        static constexpr u64 HashRound(u64 lane, u64 word) {
+            return RotateLeft(lane + word * HASH_PRIME_1, 31) * HASH_PRIME_0;
+        }
+        static constexpr u64 HashAvalanche(u64 hash) {
+            hash ^= hash >> 33;
+            hash *= HASH_PRIME_1;
+            hash ^= hash >> 29;
+            hash *= HASH_PRIME_2;
+            hash ^= hash >> 32;
+            return hash;
+        }
+        static void HashBytes(eastl::span<const u8> data, u64 (&outHash)[2]) {
+            u64 lanes[4] = { HASH_PRIME_0 + HASH_PRIME_1, HASH_PRIME_1, 0, 0 - HASH_PRIME_0 };
+            const u8* bytes = data.data();
+            usize size = data.size();
+            for (; size >= 32; size -= 32, bytes += 32) {
+                u64 words[4];
+                memcpy(words, bytes, sizeof(words));
+                for (u32 lane = 0; lane < 4; ++lane) {
+                    lanes[lane] = HashRound(lanes[lane], words[lane]);
+                }
+            }
+            u64 tail[4] = {};
+            memcpy(tail, bytes, size);
+            for (u32 lane = 0; lane < 4; ++lane) {
+                lanes[lane] = HashRound(lanes[lane], tail[lane]);
+            }
+            const u64 length = data.size() * HASH_PRIME_2;
+            outHash[0] = HashAvalanche(RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18) + length);
+            outHash[1] = HashAvalanche((lanes[0] ^ RotateLeft(lanes[2], 29)) + (lanes[3] ^ RotateLeft(lanes[1], 41)) - length);
+        }
+        template <typename T>
+        static void HashValue(u64& hash, const T& value) {
+            u8 bytes[sizeof(T)];
+            memcpy(bytes, &value, sizeof(T));
+            for (u8 byte : bytes) {
+                hash = (hash ^ byte) * 0x100000001B3ULL;
+            }
+        }
+
+        TaskResourceManager::DeduplicationKey TaskResourceManager::MakeDeduplicationKey(const TaskBufferInfo& info, eastl::span<const u8> initialData) {
+            DeduplicationKey key = {};
+            HashBytes(initialData, key.dataHash);
+            // the name is left out, identical data under different names is still shared
+            key.descriptionHash = 0xCBF29CE484222325ULL;
+            HashValue(key.descriptionHash, info.size);
+            HashValue(key.descriptionHash, info.usage);
+            HashValue(key.descriptionHash, info.mode);
+            return key;
+        }
+        TaskResourceManager::DeduplicationKey TaskResourceManager::MakeDeduplicationKey(const TaskImageInfo& info, eastl::span<const u8> initialData,
+            eastl::span<const TaskImageSubresourceData> layout) {
+            DeduplicationKey key = {};
+            HashBytes(initialData, key.dataHash);
+            key.descriptionHash = 0xCBF29CE484222325ULL;
+            HashValue(key.descriptionHash, info.flags);
+            HashValue(key.descriptionHash, info.dimensions);
+            HashValue(key.descriptionHash, info.format);
+            HashValue(key.descriptionHash, info.size);
+            HashValue(key.descriptionHash, info.mipLevelCount);
+            HashValue(key.descriptionHash, info.arrayLayerCount);
+            HashValue(key.descriptionHash, info.sampleCount);
+            HashValue(key.descriptionHash, info.usage);
+            HashValue(key.descriptionHash, info.bGenerateMips);
+            for (const TaskImageSubresourceData& subresource : layout) {
+                HashValue(key.descriptionHash, subresource.mipLevel);
+                HashValue(key.descriptionHash, subresource.arrayLayer);
+                HashValue(key.descriptionHash, subresource.offset);
+                HashValue(key.descriptionHash, subresource.rowPitch);
+            }
+            return key;
+        }
+        bool TaskResourceManager::MatchesDeduplicatedBuffer(const DeduplicatedBuffer& entry, const TaskBufferInfo& info, eastl::span<const u8> initialData) {
+            const TaskBufferInfo& cached = entry.buffer->Info();
+            return cached.size == info.size && cached.usage == info.usage && cached.mode == info.mode && entry.initialData.size() == initialData.size() &&
+                   memcmp(entry.initialData.data(), initialData.data(), initialData.size()) == 0;
+        }
+        bool TaskResourceManager::MatchesDeduplicatedImage(const DeduplicatedImage& entry, const TaskImageInfo& info, eastl::span<const u8> initialData,
+            eastl::span<const TaskImageSubresourceData> layout) {
+            const TaskImageInfo& cached = entry.image->Info();
+            if (cached.flags != info.flags || cached.dimensions != info.dimensions || cached.format != info.format || cached.size.width != info.size.width ||
+                cached.size.height != info.size.height || cached.size.depth != info.size.depth || cached.mipLevelCount != info.mipLevelCount ||
+                cached.arrayLayerCount != info.arrayLayerCount || cached.sampleCount != info.sampleCount || cached.usage != info.usage ||
+                cached.bGenerateMips != info.bGenerateMips || entry.layout.size() != layout.size() || entry.initialData.size() != initialData.size()) {
+                return false;
+            }
+            for (usize i = 0; i < layout.size(); ++i) {
+                const TaskImageSubresourceData& a = entry.layout[i];
+                const TaskImageSubresourceData& b = layout[i];
+                if (a.mipLevel != b.mipLevel || a.arrayLayer != b.arrayLayer || a.offset != b.offset || a.rowPitch != b.rowPitch) {
+                    return false;
+                }
+            }
+            return memcmp(entry.initialData.data(), initialData.data(), initialData.size()) == 0;
+        }
+
+        eastl::vector<TaskResourceManager::StagingUploadPair> TaskResourceManager::TakeStagingUploads() {
+            std::lock_guard l(mPendingStagingUploads.GetLock());
+            auto& vec = mPendingStagingUploads.UnderlyingVector();
+            // stable, so uploads of the same priority keep their creation order
+            eastl::stable_sort(vec.begin(), vec.end(), [](const StagingUploadPair& lhs, const StagingUploadPair& rhs) {
+                return lhs.priority > rhs.priority;
+            });
+            const usize budget = mUploadBudgetPerFrame;
+            usize budgetUsed = 0;
+            usize count = 0;
+            for (; count < vec.size(); ++count) {
+                const StagingUploadPair& uploadPair = vec[count];
+                if (budget != 0 && count > 0 && uploadPair.priority != TaskUploadPriority::Immediate && budgetUsed + uploadPair.size > budget) {
+                    break;
+                }
+                budgetUsed += uploadPair.size;
+            }
+            eastl::vector<StagingUploadPair> uploads = {};
+            uploads.reserve(count);
+            for (usize i = 0; i < count; ++i) {
+                // the copies are recorded before any task of the frame, so the resources can be used right away
+                for (std::atomic<bool>* resident : vec[i].resident) {
+                    resident->store(true, std::memory_order_release);
+                }
+                uploads.push_back(eastl::move(vec[i]));
+            }
+            vec.erase(vec.begin(), vec.begin() + count);
+            return uploads;
+        }
+
+        void TaskResourceManager::AddGraphFence(eastl::vector<GraphFence>& fences, TaskGraph* graph, u64 value) {
+            // values of different graphs are on different timelines, only the ones of the same graph can be merged
+            for (GraphFence& fence : fences) {
+                if (fence.graph == graph) {
+                    fence.value = eastl::max(fence.value, value);
+                    return;
+                }
+            }
+            fences.push_back({ .graph = graph, .value = value });
+        }
+        bool TaskResourceManager::AreGraphFencesDone(const eastl::vector<GraphFence>& fences) {
+            return eastl::all_of(fences.begin(), fences.end(), [](const GraphFence& fence) {
+                return fence.graph->mGpuFrameTimeline->WaitForValue(fence.value, 0);
+            });
+        }
+        bool TaskResourceManager::AreGraphFencesEnded(const eastl::vector<GraphFence>& fences) {
+            return eastl::all_of(fences.begin(), fences.end(), [](const GraphFence& fence) {
+                return fence.graph->mEndedCpuTimelineIndex.load(std::memory_order_acquire) >= fence.value;
+            });
+        }
+        void TaskResourceManager::ReleaseGraphFences(TaskGraph* graph) {
+            auto fromGraph = [graph](const GraphFence& fence) { return fence.graph == graph; };
+            {
+                std::lock_guard l(mStagingLock);
+                for (StagingPage& page : mStagingPages) {
+                    eastl::erase_if(page.fences, fromGraph);
+                }
+            }
+            std::lock_guard l(mBufferHeapLock);
+            for (BufferHeapFree& heapFree : mBufferHeapFrees) {
+                eastl::erase_if(heapFree.fences, fromGraph);
+            }
+        }
+
+        bool TaskResourceManager::IsStagingPageFree(const StagingPage& page) const {
+            return page.unflushedCount == 0 && AreGraphFencesDone(page.fences);
+        }
+
+        TaskResourceManager::StagingAllocation TaskResourceManager::AllocateStaging(usize size, const eastl::string& name) {
+            // copy offsets into images must be a multiple of the texel block size, 512 covers every format
+            constexpr usize STAGING_ALIGNMENT = 512;
+            const usize alignedSize = (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+            std::unique_lock l(mStagingLock);
+            mStagingStats.uploadedBytes += size;
+            if (alignedSize > mStagingPageSize) {
+                ++mStagingStats.dedicatedUploads;
+                Buffer staging = mDevice->CreateBuffer({
+                    .size = size,
+                    .usage = BufferUsageFlagBits::TRANSFER_SRC,
+                    .initialLayout = BufferLayout::TransferSrc,
+                    .allocationDomain = MemoryAllocationDomain::HostStaging,
+                    .name = name + " (Staging Buffer)",
+                });
+                return { .buffer = staging, .hostAddress = mDevice->BufferHostAddress(staging) };
+            }
+
+            while (mCurrentStagingPage == ~0U || mStagingPages[mCurrentStagingPage].used + alignedSize > mStagingPageSize) {
+                // recycle a page the GPU is done with, grow the ring, or wait for a flushed page
+                u32 pageIndex = ~0U;
+                for (u32 i = 0; i < mStagingPages.size() && pageIndex == ~0U; ++i) {
+                    if (IsStagingPageFree(mStagingPages[i])) {
+                        pageIndex = i;
+                    }
+                }
+                if (pageIndex == ~0U && mMaxStagingPages != 0 && mStagingPages.size() >= mMaxStagingPages) {
+                    // Only frames that were ended can be waited on, the thread recording any other frame may need this lock
+                    // to finish it. The lock is dropped while waiting, other threads keep allocating from the pages they hold.
+                    const StagingPage* waitPage = nullptr;
+                    for (const StagingPage& page : mStagingPages) {
+                        if (page.unflushedCount == 0 && AreGraphFencesEnded(page.fences)) {
+                            waitPage = &page;
+                            break;
+                        }
+                    }
+                    // pages that were never flushed, or only in frames still recording, cannot be waited on, so the ring grows past its limit
+                    if (waitPage) {
+                        const eastl::vector<GraphFence> fences = waitPage->fences;
+                        l.unlock();
+                        const auto waitStart = std::chrono::steady_clock::now();
+                        for (const GraphFence& fence : fences) {
+                            if (!fence.graph->mGpuFrameTimeline->WaitForValue(fence.value, ~0ULL)) {
+                                Logger::Fatal(mLogStream, "GPU hanging! Aborting program!");
+                            }
+                        }
+                        const f64 stallNs = std::chrono::duration<f64, std::nano>(std::chrono::steady_clock::now() - waitStart).count();
+                        l.lock();
+                        ++mStagingStats.stalls;
+                        mStagingStats.stallNs += stallNs;
+                        continue;
+                    }
+                }
+                if (pageIndex == ~0U) {
+                    pageIndex = static_cast<u32>(mStagingPages.size());
+                    Buffer buffer = mDevice->CreateBuffer({
+                        .size = mStagingPageSize,
+                        .usage = BufferUsageFlagBits::TRANSFER_SRC,
+                        .initialLayout = BufferLayout::TransferSrc,
+                        .allocationDomain = MemoryAllocationDomain::HostStaging,
+                        .name = "Staging Page #" + eastl::to_string(pageIndex),
+                    });
+                    mStagingPages.push_back({ .buffer = buffer, .hostAddress = mDevice->BufferHostAddress(buffer) });
+                    Logger::Trace(mLogStream, "Allocated staging page #{}, {} bytes", pageIndex, mStagingPageSize);
+                }
+                StagingPage& page = mStagingPages[pageIndex];
+                page.used = 0;
+                page.fences.clear();
+                mCurrentStagingPage = pageIndex;
+            }
+
+            StagingPage& page = mStagingPages[mCurrentStagingPage];
+            const usize offset = page.used;
+            page.used += alignedSize;
+            ++page.unflushedCount;
+            usize usedBytes = 0;
+            for (const StagingPage& other : mStagingPages) {
+                usedBytes += other.used;
+            }
+            mStagingStats.peakUsedBytes = eastl::max(mStagingStats.peakUsedBytes, usedBytes);
+            return { .buffer = page.buffer, .hostAddress = page.hostAddress + offset, .offset = offset, .page = mCurrentStagingPage };
+        }
+
+        void TaskResourceManager::RetireStagingUpload(const StagingUploadPair& uploadPair, TaskGraph* graph, u64 fenceValue) {
+            if (uploadPair.stagingPage == ~0U) {
+                mDevice->Destroy(uploadPair.srcBuffer, true);
+                return;
+            }
+            std::lock_guard l(mStagingLock);
+            StagingPage& page = mStagingPages[uploadPair.stagingPage];
+            ASSERT(page.unflushedCount > 0, "Staging page was flushed more often than allocated from!");
+            --page.unflushedCount;
+            AddGraphFence(page.fences, graph, fenceValue);
+        }
+
+        TaskResourceManager::BufferSuballocation TaskResourceManager::SuballocateBuffer(const TaskBufferInfo& info) {
+            // these are only ever bound with an offset and never written by the GPU after the upload, so buffers can share a heap and its layout
+            // copy sources are left out, a copy would move the whole heap out of its read only layout
+            const BufferUsageFlags suballocatedUsage = BufferUsageFlagBits::VERTEX_BUFFER | BufferUsageFlagBits::INDEX_BUFFER | BufferUsageFlagBits::DRAW_INDIRECT;
+            if (mBufferHeapSize == 0 || info.size == 0 || info.size > mMaxSuballocationSize ||
+                (info.mode != TaskBufferMode::Default && info.mode != TaskBufferMode::Host) || (info.usage | suballocatedUsage) != suballocatedUsage) {
+                return {};
+            }
+            // the smallest block keeps every suballocation aligned for vertex, index and indirect reads
+            constexpr usize MIN_SUBALLOCATION_SIZE = 256;
+            std::lock_guard l(mBufferHeapLock);
+            for (usize i = 0; i < mBufferHeapFrees.size(); ++i) {
+                const BufferHeapFree& heapFree = mBufferHeapFrees[i];
+                if (AreGraphFencesDone(heapFree.fences)) {
+                    mBufferHeaps[heapFree.heap].allocator.Free(heapFree.offset);
+                    mBufferHeapFrees.erase_unsorted(mBufferHeapFrees.begin() + i);
+                    --i;
+                }
+            }
+            for (u32 i = 0; i < mBufferHeaps.size(); ++i) {
+                BufferHeap& heap = mBufferHeaps[i];
+                if (heap.mode != info.mode) {
+                    continue;
+                }
+                const usize offset = heap.allocator.Allocate(info.size);
+                if (offset != BuddyAllocator::INVALID_OFFSET) {
+                    return { .buffer = heap.buffer, .heap = i, .offset = offset };
+                }
+            }
+            const u32 heapIndex = static_cast<u32>(mBufferHeaps.size());
+            const bool bHost = info.mode == TaskBufferMode::Host;
+            Buffer buffer = mDevice->CreateBuffer({
+                .size = mBufferHeapSize,
+                .usage = suballocatedUsage | BufferUsageFlagBits::TRANSFER_DST,
+                .initialLayout = BufferLayout::ReadOnly,
+                .allocationDomain = bHost ? MemoryAllocationDomain::HostRandomWrite : MemoryAllocationDomain::DeviceLocal,
+                .name = (bHost ? "Host Buffer Heap #" : "Device Buffer Heap #") + eastl::to_string(heapIndex),
+            });
+            mBufferHeaps.push_back({ .buffer = buffer, .mode = info.mode, .allocator = BuddyAllocator(mBufferHeapSize, MIN_SUBALLOCATION_SIZE) });
+            Logger::Trace(mLogStream, "Allocated buffer heap #{}, {} bytes", heapIndex, mBufferHeapSize);
+            return { .buffer = buffer, .heap = heapIndex, .offset = mBufferHeaps.back().allocator.Allocate(info.size) };
+        }
+
+        void TaskResourceManager::FreeBufferSuballocation(u32 heap, usize offset, usize size) {
+            // every graph may have read the range in any frame it started so far, each one on its own timeline
+            // the graph list stays locked until the free is queued, a graph destroyed meanwhile drops its entry in ReleaseGraphFences()
+            BufferHeapFree heapFree = { .heap = heap, .offset = offset, .size = size };
+            std::lock_guard graphsLock(mTaskGraphs.GetLock());
+            for (TaskGraph* graph : mTaskGraphs.UnderlyingVector()) {
+                AddGraphFence(heapFree.fences, graph, graph->mBegunCpuTimelineIndex.load(std::memory_order_acquire));
+            }
+            std::lock_guard l(mBufferHeapLock);
+            mBufferHeapFrees.push_back(eastl::move(heapFree));
+        }
+
+        void TaskResourceManager::RegisterBufferHeapLayouts() {
+            std::lock_guard l(mBufferHeapLock);
+            auto& states = GetResourceStateMap();
+            for (; mRegisteredBufferHeaps < mBufferHeaps.size(); ++mRegisteredBufferHeaps) {
+                states.mLastKnownBufferLayouts[mBufferHeaps[mRegisteredBufferHeaps].buffer] = BufferLayout::ReadOnly;
+            }
+        }
+
+        TaskBufferHeapStats TaskResourceManager::GetBufferHeapStats() {
+            std::lock_guard l(mBufferHeapLock);
+            TaskBufferHeapStats stats = {};
+            stats.heapCount = static_cast<u32>(mBufferHeaps.size());
+            for (const BufferHeap& heap : mBufferHeaps) {
+                stats.suballocationCount += heap.allocator.AllocationCount();
+                stats.capacity += heap.allocator.Size();
+                stats.usedBytes += heap.allocator.UsedBytes();
+            }
+            for (const BufferHeapFree& heapFree : mBufferHeapFrees) {
+                --stats.suballocationCount;
+                stats.pendingFreeBytes += heapFree.size;
+            }
+            return stats;
         }
 
         IShaderReloadListener* TaskResourceManager::GetShaderReloadListener() {
@@ -493,6 +1197,7 @@ namespace PyroshockStudios {
         }
         void TaskResourceManager::RegisterResource(TaskResource_* resource) {
             resource->mOwner = this;
+            std::lock_guard l(mResourceSlotLock);
             if (mTombstones.Empty()) {
                 resource->mId = static_cast<u32>(mResources.Size());
                 mResources.EmplaceBack(resource);
@@ -504,6 +1209,7 @@ namespace PyroshockStudios {
 
         void TaskResourceManager::ReleaseResource(TaskResource_* resource) {
             u32 slot = resource->GetId();
+            std::lock_guard l(mResourceSlotLock);
             ASSERT(mResources.Size() > slot, "Bad slot!");
             ASSERT(mResources.At(slot) != nullptr, "Double delete!");
             ASSERT(!mTombstones.Contains(slot), "Double delete!");
@@ -523,7 +1229,8 @@ namespace PyroshockStudios {
                         states.mLastKnownBufferLayouts.erase(it);
                     }
                 }
-            } else {
+            } else if (!resource->IsSuballocated()) {
+                // the layout of a heap is shared by every buffer in it
                 auto it = states.mLastKnownBufferLayouts.find(resource->Internal());
                 if (it != states.mLastKnownBufferLayouts.end()) {
                     states.mLastKnownBufferLayouts.erase(it);
@@ -535,11 +1242,12 @@ namespace PyroshockStudios {
                 for (auto& staging : vec) {
                     for (i32 i = 0; i < staging.uploads.size(); ++i) {
                         auto& upload = staging.uploads[i];
-                        if (upload.dstBuffer == resource->Internal()) {
+                        if (upload.dstBuffer == resource->Internal() && upload.dstBufferOffset == resource->mHeapOffset) {
                             staging.uploads.erase(staging.uploads.begin() + i);
                             --i;
                         }
                     }
+                    staging.resident.erase(eastl::remove(staging.resident.begin(), staging.resident.end(), &resource->mbResident), staging.resident.end());
                 }
             }
         }
@@ -557,6 +1265,7 @@ namespace PyroshockStudios {
                             --i;
                         }
                     }
+                    staging.resident.erase(eastl::remove(staging.resident.begin(), staging.resident.end(), &resource->mbResident), staging.resident.end());
                 }
             }
             auto it = states.mLastKnownImageLayouts.find(resource->Internal());
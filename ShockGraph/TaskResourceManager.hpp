@@ -22,6 +22,8 @@
 
 #pragma once
 #include "Resources.hpp"
+#include "BuddyAllocator.hpp"
+#include "StagingCopyPool.hpp"
 
 #include <EASTL/hash_map.h>
 #include <EASTL/utility.h>
@@ -29,6 +31,7 @@
 #include <PyroRHI/Api/Forward.hpp>
 #include <PyroRHI/Common/AtomicVector.hpp>
 #include <ShockGraph/Core.hpp>
+#include <mutex>
 
 namespace PyroshockStudios {
     inline namespace ShockGraph {
@@ -41,6 +44,103 @@ namespace PyroshockStudios {
             RHIContext* rhi = nullptr;
             IDevice* device = nullptr;
             u32 framesInFlight = {};
+            /**
+             * @brief Size of the pages initial data is staged in. Larger uploads get a dedicated staging buffer.
+             */
+            usize stagingPageSize = 16 * 1024 * 1024;
+            /**
+             * @brief Pages kept before uploads wait for the GPU to recycle one, 0 never waits.
+             */
+            u32 maxStagingPages = 8;
+            /**
+             * @brief Bytes of initial data uploaded per frame, 0 uploads everything in the next frame.
+             * At least one upload is made per frame, Immediate uploads ignore the budget.
+             */
+            usize uploadBudgetPerFrame = 0;
+            /**
+             * @brief Worker threads that help copy large initial data into staging memory, 0 copies on the creating thread only.
+             */
+            u32 stagingCopyThreads = 2;
+            /**
+             * @brief Shares buffers and images created with identical initial data and description instead of uploading them again.
+             * Shared resources must only be read, resources with unordered access, render target or transfer destination usage and CPU accessible
+             * buffers are never shared.
+             * The cache holds a reference and a copy of the initial data of every shared resource until ClearDeduplicationCache().
+             * Resources created through CreatePersistentResources() are not deduplicated.
+             */
+            bool bDeduplicateInitialData = false;
+            /**
+             * @brief Size of the heaps small buffers are suballocated from, 0 gives every buffer its own allocation. Must be a power of two.
+             * Only Default and Host buffers that the GPU reads as vertex, index or indirect data are suballocated,
+             * TaskBuffer_::Region() is the range such a buffer occupies in TaskBuffer_::Internal().
+             */
+            usize bufferHeapSize = 0;
+            /**
+             * @brief Largest buffer that is suballocated, larger ones get their own allocation.
+             */
+            usize maxSuballocationSize = 256 * 1024;
+        };
+        /**
+         * @brief Where the data of one mip level of one array layer starts in the initial data of an image.
+         * Cube faces are array layers, face f of cube c is layer 6 * c + f.
+         */
+        struct TaskImageSubresourceData {
+            u32 mipLevel = 0;
+            u32 arrayLayer = 0;
+            usize offset = 0;
+            /**
+             * @brief Bytes per row of blocks in the initial data, 0 if the rows are tightly packed.
+             */
+            u32 rowPitch = 0;
+        };
+        enum struct TaskUploadPriority : u32 {
+            Low = 0,
+            Normal = 1,
+            High = 2,
+            Immediate = 3, ///< Uploaded in the next frame regardless of the budget.
+        };
+        struct TaskStagingStats {
+            u32 pageCount = 0;
+            usize pageCapacity = 0;
+            /**
+             * @brief Bytes allocated in pages that have not been recycled yet.
+             */
+            usize usedBytes = 0;
+            usize peakUsedBytes = 0;
+            usize uploadedBytes = 0;
+            u32 dedicatedUploads = 0;
+            /**
+             * @brief Uploads that had to wait for the GPU to recycle a page, and the total time waited.
+             */
+            u32 stalls = 0;
+            f64 stallNs = 0.0;
+            /**
+             * @brief Uploads waiting for a frame with enough budget left.
+             */
+            u32 pendingUploads = 0;
+            usize pendingUploadBytes = 0;
+        };
+        struct TaskDeduplicationStats {
+            u32 entries = 0;
+            u32 hits = 0;
+            u32 misses = 0;
+            /**
+             * @brief Device memory that was neither allocated nor uploaded again because an identical resource existed.
+             */
+            usize savedBytes = 0;
+        };
+        struct TaskBufferHeapStats {
+            u32 heapCount = 0;
+            u32 suballocationCount = 0;
+            usize capacity = 0;
+            /**
+             * @brief Bytes of the heaps in use, including the rounding of every suballocation up to a power of two.
+             */
+            usize usedBytes = 0;
+            /**
+             * @brief Bytes of released buffers the GPU may still be reading.
+             */
+            usize pendingFreeBytes = 0;
         };
         struct TaskBufferResourceInfo {
             TaskBuffer buffer = {};
@@ -53,6 +153,21 @@ namespace PyroshockStudios {
             Format format = Format::Inherit;
         };
 
+        struct TaskBufferCreateInfo {
+            TaskBufferInfo info = {};
+            eastl::span<const u8> initialData = {};
+        };
+        struct TaskImageCreateInfo {
+            TaskImageInfo info = {};
+            eastl::span<const u8> initialData = {};
+            eastl::span<const TaskImageSubresourceData> layout = {};
+        };
+        struct TaskResourceBatchInfo {
+            eastl::span<const TaskBufferCreateInfo> buffers = {};
+            eastl::span<const TaskImageCreateInfo> images = {};
+            TaskUploadPriority priority = TaskUploadPriority::Normal;
+        };
+
         using TaskSamplerInfo = SamplerInfo;
         class TaskResourceManager : public ILoggerAware, DeleteCopy, DeleteMove {
         public:
@@ -65,8 +180,20 @@ namespace PyroshockStudios {
             SHOCKGRAPH_API TaskResourceManager(const TaskResourceManagerInfo& info);
             SHOCKGRAPH_API ~TaskResourceManager();
 
-            PYRO_NODISCARD SHOCKGRAPH_API TaskBuffer CreatePersistentBuffer(const TaskBufferInfo& info, eastl::span<const u8> initialData = {});
-            PYRO_NODISCARD SHOCKGRAPH_API TaskImage CreatePersistentImage(const TaskImageInfo& info, eastl::span<const u8> initialData = {});
+            PYRO_NODISCARD SHOCKGRAPH_API TaskBuffer CreatePersistentBuffer(const TaskBufferInfo& info, eastl::span<const u8> initialData = {},
+                TaskUploadPriority priority = TaskUploadPriority::Normal);
+            /**
+             * @brief Creates an image, uploading initialData into every mip level and array layer.
+             * Without a layout the data is tightly packed, every mip level of layer 0 first, then those of layer 1 and so on.
+             * A layout may also cover only some of the subresources.
+             */
+            PYRO_NODISCARD SHOCKGRAPH_API TaskImage CreatePersistentImage(const TaskImageInfo& info, eastl::span<const u8> initialData = {},
+                TaskUploadPriority priority = TaskUploadPriority::Normal, eastl::span<const TaskImageSubresourceData> layout = {});
+            /**
+             * @brief Creates every buffer and image of a batch in descriptor order. Their initial data is packed into
+             * one staging allocation and uploaded as a single record, so the whole batch becomes resident in the same frame.
+             */
+            SHOCKGRAPH_API void CreatePersistentResources(const TaskResourceBatchInfo& info, eastl::span<TaskBuffer> outBuffers, eastl::span<TaskImage> outImages);
             PYRO_NODISCARD SHOCKGRAPH_API TaskBlas CreatePersistentBlas(const TaskBlasInfo& info);
             PYRO_NODISCARD SHOCKGRAPH_API TaskTlas CreatePersistentTlas(const TaskTlasInfo& info);
 
@@ -94,7 +221,37 @@ namespace PyroshockStudios {
 
             PYRO_NODISCARD SHOCKGRAPH_API TaskSwapChain CreateSwapChain(const TaskSwapChainInfo& info);
 
+            /**
+             * @brief Changes the number of frames in flight without recreating persistent resources or rebuilding task graphs.
+             * Waits for the device to be idle, then resizes the in-flight copies of Dynamic, HostDynamic and Readback buffers
+             * and the timestamp pools of every task graph. Must be called outside of a frame.
+             * Swap chains keep the buffer count they were created with.
+             */
             SHOCKGRAPH_API void SetFramesInFlight(u32 newFramesInFlight);
+            PYRO_NODISCARD SHOCKGRAPH_API TaskStagingStats GetStagingStats();
+            /**
+             * @brief Moves the queued initial data of a resource to the next frame regardless of the upload budget.
+             * Tasks that cannot run without the data call this before the frame, others can skip themselves
+             * until IsResident() through GenericTask::SetEnablePredicate().
+             */
+            SHOCKGRAPH_API void MakeResident(TaskBuffer buffer);
+            SHOCKGRAPH_API void MakeResident(TaskImage image);
+            SHOCKGRAPH_API void SetUploadBudget(usize bytesPerFrame);
+            /**
+             * @brief Pipeline used for images created with TaskImageInfo::bGenerateMips, compiled from
+             * resources/Shaders/GenerateMips.slang (entry point generateMipsMain).
+             */
+            SHOCKGRAPH_API void SetMipGenerationPipeline(TaskComputePipeline pipeline);
+            PYRO_NODISCARD SHOCKGRAPH_API TaskDeduplicationStats GetDeduplicationStats();
+            PYRO_NODISCARD SHOCKGRAPH_API TaskBufferHeapStats GetBufferHeapStats();
+            /**
+             * @brief Forgets every shared resource, later resources with the same initial data get their own copy.
+             * Cached resources the application no longer references are freed.
+             */
+            SHOCKGRAPH_API void ClearDeduplicationCache();
+            PYRO_NODISCARD PYRO_FORCEINLINE u32 GetFramesInFlight() const {
+                return mFramesInFlight;
+            }
 
             PYRO_NODISCARD SHOCKGRAPH_API IShaderReloadListener* GetShaderReloadListener();
 
@@ -116,24 +273,163 @@ namespace PyroshockStudios {
             void ReleaseResource(TaskResource_* resource);
             void ReleaseBufferResource(TaskBuffer_* resource);
             void ReleaseImageResource(TaskImage_* resource);
+            PYRO_NODISCARD Buffer CreateInFlightBuffer(const TaskBufferInfo& info, u32 index, BufferUsageFlags extraRequiredFlags = {});
             friend struct TaskBuffer_;
             friend struct TaskImage_;
 
+            // taking a tombstone and filling its slot must happen as one step, resources are created from streaming threads
+            std::mutex mResourceSlotLock = {};
             Common::AtomicVector<u32> mTombstones = {};
             Common::AtomicVector<TaskResource_*> mResources = {};
 
             struct StagingUploadData {
+                usize srcOffset = {};
                 Buffer dstBuffer = {};
+                usize dstBufferOffset = {};
+                usize dstBufferSize = {};
                 BufferLayout dstBufferLayout = {};
                 Image dstImage = {};
                 ImageLayout dstImageLayout = {};
                 ImageArraySlice dstImageSlice = {};
+                Extent3D dstImageExtent = {};
                 u32 rowPitch = {};
+                bool bGenerateMips = false;
             };
             struct StagingUploadPair {
                 Buffer srcBuffer = {};
+                // page the source was allocated from, ~0U for dedicated staging buffers
+                u32 stagingPage = ~0U;
+                usize size = 0;
+                TaskUploadPriority priority = TaskUploadPriority::Normal;
+                // residency flags of the destinations, removed if one is released before the upload
+                eastl::vector<std::atomic<bool>*> resident = {};
                 eastl::vector<StagingUploadData> uploads = {};
             };
+            struct StagingAllocation {
+                Buffer buffer = PYRO_NULL_BUFFER;
+                u8* hostAddress = nullptr;
+                usize offset = 0;
+                u32 page = ~0U;
+            };
+            // frame timeline value of the last frame a task graph used a recycled allocation in, one entry per graph
+            struct GraphFence {
+                TaskGraph* graph = nullptr;
+                u64 value = 0;
+            };
+            static void AddGraphFence(eastl::vector<GraphFence>& fences, TaskGraph* graph, u64 value);
+            PYRO_NODISCARD static bool AreGraphFencesDone(const eastl::vector<GraphFence>& fences);
+            // graph fences of frames that were not ended yet may never be signalled while the waiting thread blocks
+            PYRO_NODISCARD static bool AreGraphFencesEnded(const eastl::vector<GraphFence>& fences);
+            /**
+             * @brief Drops every fence of a graph that is destroyed, the GPU must be done with it.
+             */
+            void ReleaseGraphFences(TaskGraph* graph);
+
+            struct StagingPage {
+                Buffer buffer = PYRO_NULL_BUFFER;
+                u8* hostAddress = nullptr;
+                usize used = 0;
+                // uploads not flushed by a task graph yet, the page cannot be recycled before
+                u32 unflushedCount = 0;
+                // frames that flushed uploads from the page
+                eastl::vector<GraphFence> fences = {};
+            };
+            PYRO_NODISCARD StagingAllocation AllocateStaging(usize size, const eastl::string& name);
+            PYRO_NODISCARD bool IsStagingPageFree(const StagingPage& page) const;
+            void RetireStagingUpload(const StagingUploadPair& uploadPair, TaskGraph* graph, u64 fenceValue);
+            PYRO_NODISCARD eastl::vector<StagingUploadPair> TakeStagingUploads();
+            void PrioritizeUpload(std::atomic<bool>* resident);
+
+            // one region of the initial data of an image, offsets are relative to the start of the image's staging range
+            struct ImageUploadRegion {
+                TaskImageSubresourceData subresource = {};
+                Extent3D extent = {};
+                u32 blocksY = 0;
+                u32 tightRowPitch = 0;
+                u32 srcRowPitch = 0;
+                u32 alignedRowPitch = 0;
+                DeviceSize stagingOffset = 0;
+            };
+            PYRO_NODISCARD DeviceSize PlanImageUpload(const TaskImageInfo& info, eastl::span<const u8> initialData,
+                eastl::span<const TaskImageSubresourceData> layout, eastl::vector<ImageUploadRegion>& regions) const;
+            // create the resource and append its staging copies and upload records, the caller copies and queues them
+            PYRO_NODISCARD TaskBuffer CreateBufferResource(const TaskBufferInfo& info, eastl::span<const u8> initialData, const StagingAllocation& staging,
+                usize stagingOffset, StagingUploadPair& uploadPair, eastl::vector<StagingCopyRegion>& copies);
+            PYRO_NODISCARD TaskImage CreateImageResource(const TaskImageInfo& info, eastl::span<const u8> initialData, eastl::span<const ImageUploadRegion> regions,
+                const StagingAllocation& staging, usize stagingOffset, StagingUploadPair& uploadPair, eastl::vector<StagingCopyRegion>& copies);
+            // content hash of the initial data and hash of the description, both must match to share a resource
+            struct DeduplicationKey {
+                u64 dataHash[2] = {};
+                u64 descriptionHash = 0;
+
+                PYRO_NODISCARD bool operator==(const DeduplicationKey&) const = default;
+            };
+            struct DeduplicationKeyHash {
+                PYRO_NODISCARD usize operator()(const DeduplicationKey& key) const {
+                    return static_cast<usize>(key.dataHash[0] ^ key.descriptionHash);
+                }
+            };
+            PYRO_NODISCARD static DeduplicationKey MakeDeduplicationKey(const TaskBufferInfo& info, eastl::span<const u8> initialData);
+            PYRO_NODISCARD static DeduplicationKey MakeDeduplicationKey(const TaskImageInfo& info, eastl::span<const u8> initialData,
+                eastl::span<const TaskImageSubresourceData> layout);
+            // entries own their resource, so a hit can never hand out a resource whose last reference is being released.
+            // The initial data is kept to compare against on a hit, equal keys only narrow down the candidate
+            struct DeduplicatedBuffer {
+                TaskBuffer buffer = {};
+                eastl::vector<u8> initialData = {};
+            };
+            struct DeduplicatedImage {
+                TaskImage image = {};
+                eastl::vector<u8> initialData = {};
+                eastl::vector<TaskImageSubresourceData> layout = {};
+            };
+            PYRO_NODISCARD static bool MatchesDeduplicatedBuffer(const DeduplicatedBuffer& entry, const TaskBufferInfo& info, eastl::span<const u8> initialData);
+            PYRO_NODISCARD static bool MatchesDeduplicatedImage(const DeduplicatedImage& entry, const TaskImageInfo& info, eastl::span<const u8> initialData,
+                eastl::span<const TaskImageSubresourceData> layout);
+            std::mutex mDeduplicationLock = {};
+            bool mbDeduplicateInitialData = false;
+            eastl::hash_map<DeduplicationKey, DeduplicatedBuffer, DeduplicationKeyHash> mDeduplicatedBuffers = {};
+            eastl::hash_map<DeduplicationKey, DeduplicatedImage, DeduplicationKeyHash> mDeduplicatedImages = {};
+            TaskDeduplicationStats mDeduplicationStats = {};
+
+            // heaps small read only buffers are suballocated from, one buffer mode each
+            struct BufferHeap {
+                Buffer buffer = PYRO_NULL_BUFFER;
+                TaskBufferMode mode = TaskBufferMode::Default;
+                BuddyAllocator allocator = {};
+            };
+            // a released suballocation, reused once the latest frame of every task graph at release time retired
+            struct BufferHeapFree {
+                u32 heap = ~0U;
+                usize offset = 0;
+                usize size = 0;
+                eastl::vector<GraphFence> fences = {};
+            };
+            struct BufferSuballocation {
+                Buffer buffer = PYRO_NULL_BUFFER;
+                u32 heap = ~0U;
+                usize offset = 0;
+            };
+            PYRO_NODISCARD BufferSuballocation SuballocateBuffer(const TaskBufferInfo& info);
+            void FreeBufferSuballocation(u32 heap, usize offset, usize size);
+            // the resource state map is only written while recording, heaps created on other threads are registered there
+            void RegisterBufferHeapLayouts();
+            std::mutex mBufferHeapLock = {};
+            eastl::vector<BufferHeap> mBufferHeaps = {};
+            u32 mRegisteredBufferHeaps = 0;
+            eastl::vector<BufferHeapFree> mBufferHeapFrees = {};
+            usize mBufferHeapSize = 0;
+            usize mMaxSuballocationSize = 0;
+
+            std::mutex mStagingLock = {};
+            eastl::vector<StagingPage> mStagingPages = {};
+            u32 mCurrentStagingPage = ~0U;
+            usize mStagingPageSize = 0;
+            u32 mMaxStagingPages = 0;
+            TaskStagingStats mStagingStats = {};
+            std::atomic<usize> mUploadBudgetPerFrame = 0;
+            StagingCopyPool mStagingCopyPool;
+            TaskComputePipeline mMipGenerationPipeline = {};
             //struct MappedMemoryFlush {
             //    Buffer dstBuffer = {};
             //    BufferLayout dstBufferLayout = {};
@@ -141,6 +437,8 @@ namespace PyroshockStudios {
             Common::AtomicVector<StagingUploadPair> mPendingStagingUploads = {};
             //Common::AtomicVector<StagingUploadPair> mPendingMappedMemoryFlushes = {};
             Common::AtomicVector<TaskBuffer_*> mDynamicBuffers = {};
+            // every task graph of this manager, they own per frame state too
+            Common::AtomicVector<TaskGraph*> mTaskGraphs = {};
 
             IDevice* mDevice = nullptr;
             RHIContext* mRHI = nullptr;
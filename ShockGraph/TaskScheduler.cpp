@@ -0,0 +1,259 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "TaskScheduler.hpp"
+
+#include <EASTL/algorithm.h>
+#include <EASTL/sort.h>
+#include <libassert/assert.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        struct SimulatedBatch {
+            eastl::vector<eastl::pair<TaskType, f64>> tasks = {};
+            u32 barrierCount = 0;
+        };
+
+        static f64 TaskCostNs(f64 weightNs, const TaskScheduleCostModel& model) {
+            return weightNs > 0.0 ? weightNs : model.unmeasuredTaskCostNs;
+        }
+        static f64 BatchTimeNs(f64 sumNs, f64 maxNs, const TaskScheduleCostModel& model) {
+            return sumNs - model.overlapEfficiency * (sumNs - maxNs);
+        }
+        static f64 SwitchCostNs(TaskType from, TaskType to, const TaskScheduleCostModel& model) {
+            if (from == TaskType::None || to == TaskType::None || from == to) {
+                return 0.0;
+            }
+            f64 cost = model.pipelineSwitchCostNs;
+            if (from == TaskType::Graphics || to == TaskType::Graphics) {
+                cost += model.renderPassBreakCostNs;
+            }
+            return cost;
+        }
+
+        static f64 Simulate(const eastl::vector<SimulatedBatch>& batches, const TaskScheduleCostModel& model) {
+            f64 totalNs = 0.0;
+            TaskType previousType = TaskType::None;
+            for (const SimulatedBatch& batch : batches) {
+                f64 sumNs = 0.0;
+                f64 maxNs = 0.0;
+                for (const auto& [type, weightNs] : batch.tasks) {
+                    const f64 costNs = TaskCostNs(weightNs, model);
+                    sumNs += costNs;
+                    maxNs = eastl::max(maxNs, costNs);
+                    totalNs += SwitchCostNs(previousType, type, model);
+                    if (type != TaskType::None) {
+                        previousType = type;
+                    }
+                }
+                totalNs += BatchTimeNs(sumNs, maxNs, model);
+                if (batch.barrierCount > 0) {
+                    totalNs += model.barrierPointCostNs + batch.barrierCount * model.barrierCostNs;
+                }
+            }
+            return totalNs;
+        }
+
+        // Groups tasks by type, keeping the type of the previous batch first and the type of the next batch last
+        static void SortBatches(const TaskScheduleInfo& info, TaskSchedule& batches) {
+            TaskType previousTaskType = TaskType::None;
+            for (usize i = 0; i < batches.size(); ++i) {
+                auto& batch = batches[i];
+
+                TaskType nextBatchFirstType = TaskType::None;
+                if (i + 1 < batches.size() && !batches[i + 1].empty()) {
+                    nextBatchFirstType = info.tasks[batches[i + 1].front()].type;
+                }
+
+                eastl::sort(batch.begin(), batch.end(), [&info, previousTaskType, nextBatchFirstType](TaskId a, TaskId b) {
+                    const TaskType typeA = info.tasks[a].type;
+                    const TaskType typeB = info.tasks[b].type;
+
+                    if (typeA == previousTaskType && typeB != previousTaskType) {
+                        return true;
+                    }
+                    if (typeA != previousTaskType && typeB == previousTaskType) {
+                        return false;
+                    }
+
+                    if (nextBatchFirstType != TaskType::None) {
+                        if (typeA == nextBatchFirstType && typeB != nextBatchFirstType) {
+                            return false;
+                        }
+                        if (typeA != nextBatchFirstType && typeB == nextBatchFirstType) {
+                            return true;
+                        }
+                    }
+
+                    return typeA < typeB;
+                });
+
+                if (!batch.empty()) {
+                    previousTaskType = info.tasks[batch.back()].type;
+                }
+            }
+        }
+
+        void DefaultTaskScheduler::Schedule(const TaskScheduleInfo& info, TaskSchedule& batches) {
+            SortBatches(info, batches);
+        }
+
+        void CostModelTaskScheduler::Schedule(const TaskScheduleInfo& info, TaskSchedule& batches) {
+            const usize taskCount = info.tasks.size();
+            const usize batchCount = batches.size();
+            if (taskCount == 0 || batchCount == 0) {
+                mLastEstimatedTimeNs = 0.0;
+                return;
+            }
+
+            TaskSchedule fallback = batches;
+            SortBatches(info, fallback);
+            const f64 fallbackTimeNs = EstimateScheduleTimeNs(info, fallback, mModel);
+
+            eastl::vector<bool> bScheduled(taskCount, false);
+            for (const auto& batch : batches) {
+                for (TaskId task : batch) {
+                    bScheduled[task] = true;
+                }
+            }
+
+            // latest batch every task can go into without pushing a dependent past the last batch.
+            // Dependents always have a higher id than their dependencies, so walk the ids backwards
+            eastl::vector<u32> latestBatch(taskCount, static_cast<u32>(batchCount - 1));
+            for (usize task = taskCount; task-- > 0;) {
+                if (!bScheduled[task]) {
+                    continue;
+                }
+                for (TaskId dependent : info.tasks[task].dependents) {
+                    ASSERT(latestBatch[dependent] > 0, "Dependent task cannot be scheduled in the first batch!");
+                    latestBatch[task] = eastl::min(latestBatch[task], latestBatch[dependent] - 1);
+                }
+            }
+
+            struct BatchState {
+                f64 sumNs = 0.0;
+                f64 maxNs = 0.0;
+                u32 typeMask = 0;
+                u32 barrierCount = 0;
+                eastl::vector<TaskId> tasks = {};
+            };
+            eastl::vector<BatchState> states(batchCount);
+            eastl::vector<u32> placedBatch(taskCount, 0);
+
+            // greedy list scheduling, dependencies always come first in id order
+            for (usize task = 0; task < taskCount; ++task) {
+                if (!bScheduled[task]) {
+                    continue;
+                }
+                const TaskScheduleNode& node = info.tasks[task];
+                const f64 costNs = TaskCostNs(node.weightNs, mModel);
+                const u32 typeBit = 1u << static_cast<u32>(node.type);
+
+                u32 earliest = 0;
+                for (TaskId dependency : node.dependencies) {
+                    earliest = eastl::max(earliest, placedBatch[dependency] + 1);
+                }
+                ASSERT(earliest <= latestBatch[task], "Dependencies were placed past the latest legal batch!");
+
+                u32 bestBatch = earliest;
+                f64 bestDeltaNs = 0.0;
+                for (u32 batchIndex = earliest; batchIndex <= latestBatch[task]; ++batchIndex) {
+                    const BatchState& state = states[batchIndex];
+                    f64 deltaNs = BatchTimeNs(state.sumNs + costNs, eastl::max(state.maxNs, costNs), mModel) -
+                                  BatchTimeNs(state.sumNs, state.maxNs, mModel);
+                    if (node.barrierCount > 0) {
+                        deltaNs += node.barrierCount * mModel.barrierCostNs;
+                        if (state.barrierCount == 0) {
+                            deltaNs += mModel.barrierPointCostNs;
+                        }
+                    }
+                    if (state.typeMask != 0 && !(state.typeMask & typeBit)) {
+                        // joining a batch of a different type costs at least one switch
+                        deltaNs += mModel.pipelineSwitchCostNs;
+                        if (node.type == TaskType::Graphics || state.typeMask & (1u << static_cast<u32>(TaskType::Graphics))) {
+                            deltaNs += mModel.renderPassBreakCostNs;
+                        }
+                    }
+                    if (batchIndex == earliest || deltaNs < bestDeltaNs) {
+                        bestDeltaNs = deltaNs;
+                        bestBatch = batchIndex;
+                    }
+                }
+
+                BatchState& state = states[bestBatch];
+                state.sumNs += costNs;
+                state.maxNs = eastl::max(state.maxNs, costNs);
+                state.typeMask |= typeBit;
+                state.barrierCount += node.barrierCount;
+                state.tasks.push_back(static_cast<TaskId>(task));
+                placedBatch[task] = bestBatch;
+            }
+
+            TaskSchedule candidate = {};
+            candidate.reserve(batchCount);
+            for (BatchState& state : states) {
+                if (!state.tasks.empty()) {
+                    candidate.emplace_back(eastl::move(state.tasks));
+                }
+            }
+            SortBatches(info, candidate);
+
+            const f64 candidateTimeNs = EstimateScheduleTimeNs(info, candidate, mModel);
+            if (candidateTimeNs < fallbackTimeNs) {
+                batches = eastl::move(candidate);
+                mLastEstimatedTimeNs = candidateTimeNs;
+            } else {
+                batches = eastl::move(fallback);
+                mLastEstimatedTimeNs = fallbackTimeNs;
+            }
+        }
+
+        f64 EstimateScheduleTimeNs(const TaskScheduleInfo& info, const TaskSchedule& batches, const TaskScheduleCostModel& model) {
+            eastl::vector<SimulatedBatch> simulated(batches.size());
+            for (usize i = 0; i < batches.size(); ++i) {
+                for (TaskId id : batches[i]) {
+                    const TaskScheduleNode& node = info.tasks[id];
+                    simulated[i].tasks.emplace_back(node.type, node.weightNs);
+                    simulated[i].barrierCount += node.barrierCount;
+                }
+            }
+            return Simulate(simulated, model);
+        }
+
+        f64 SimulateFrameTimeNs(const TaskGraphDebugInfo& debugInfo, const TaskScheduleCostModel& model) {
+            eastl::vector<SimulatedBatch> simulated(debugInfo.batches.size());
+            for (usize i = 0; i < debugInfo.batches.size(); ++i) {
+                const TaskDebugBatch& batch = debugInfo.batches[i];
+                for (TaskId id : batch.tasks) {
+                    auto it = debugInfo.tasks.find(id);
+                    if (it == debugInfo.tasks.end()) {
+                        simulated[i].tasks.emplace_back(TaskType::None, 0.0);
+                    } else {
+                        simulated[i].tasks.emplace_back(it->second.type, it->second.timingNs);
+                    }
+                }
+                simulated[i].barrierCount = static_cast<u32>(batch.bufferBarriers.size() + batch.imageBarriers.size() + batch.asBarriers.size());
+            }
+            return Simulate(simulated, model);
+        }
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,102 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "ITaskScheduler.hpp"
+#include "TaskGraph.hpp"
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        struct TaskScheduleCostModel {
+            /**
+             * @brief Cost of every batch that issues at least one barrier (the GPU drains before continuing).
+             */
+            f64 barrierPointCostNs = 2000.0;
+            /**
+             * @brief Cost of every individual barrier.
+             */
+            f64 barrierCostNs = 100.0;
+            /**
+             * @brief Cost of switching between graphics, compute and transfer work.
+             */
+            f64 pipelineSwitchCostNs = 500.0;
+            /**
+             * @brief Extra cost when a switch starts or ends graphics work, as it breaks up render passes.
+             */
+            f64 renderPassBreakCostNs = 1000.0;
+            /**
+             * @brief Weight of tasks that have no GPU timings yet.
+             */
+            f64 unmeasuredTaskCostNs = 50000.0;
+            /**
+             * @brief Fraction [0, 1] of the work inside a batch that overlaps with the longest task of the batch.
+             */
+            f64 overlapEfficiency = 0.5;
+        };
+
+        /**
+         * @brief Keeps the as-soon-as-possible batching and groups tasks of the same type
+         * next to the neighbouring batches.
+         */
+        class DefaultTaskScheduler : public ITaskScheduler {
+        public:
+            SHOCKGRAPH_API DefaultTaskScheduler() = default;
+            SHOCKGRAPH_API ~DefaultTaskScheduler() override = default;
+
+            SHOCKGRAPH_API void Schedule(const TaskScheduleInfo& info, TaskSchedule& batches) override;
+            PYRO_NODISCARD const char* GetName() const override { return "DefaultTaskScheduler"; }
+        };
+
+        /**
+         * @brief Moves tasks with slack between their legal batches to cut barrier points and pipeline switches,
+         * weighting tasks by their measured GPU timings. Falls back to the default schedule if that is estimated to be faster.
+         */
+        class CostModelTaskScheduler : public ITaskScheduler {
+        public:
+            SHOCKGRAPH_API CostModelTaskScheduler(const TaskScheduleCostModel& model = {}) : mModel(model) {}
+            SHOCKGRAPH_API ~CostModelTaskScheduler() override = default;
+
+            SHOCKGRAPH_API void Schedule(const TaskScheduleInfo& info, TaskSchedule& batches) override;
+            PYRO_NODISCARD const char* GetName() const override { return "CostModelTaskScheduler"; }
+
+            PYRO_NODISCARD PYRO_FORCEINLINE const TaskScheduleCostModel& Model() const { return mModel; }
+            /**
+             * @brief Estimated frame time of the schedule picked by the last Schedule() call.
+             */
+            PYRO_NODISCARD PYRO_FORCEINLINE f64 LastEstimatedTimeNs() const { return mLastEstimatedTimeNs; }
+
+        private:
+            TaskScheduleCostModel mModel = {};
+            f64 mLastEstimatedTimeNs = 0.0;
+        };
+
+        /**
+         * @brief Estimates the GPU time of a schedule with the given cost model, without touching the GPU.
+         */
+        PYRO_NODISCARD SHOCKGRAPH_API f64 EstimateScheduleTimeNs(const TaskScheduleInfo& info, const TaskSchedule& batches, const TaskScheduleCostModel& model = {});
+        /**
+         * @brief Estimates the GPU time of a baked task graph from its debug info, without touching the GPU.
+         */
+        PYRO_NODISCARD SHOCKGRAPH_API f64 SimulateFrameTimeNs(const TaskGraphDebugInfo& debugInfo, const TaskScheduleCostModel& model = {});
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,77 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "ITaskScheduler.hpp"
+#include <EASTL/string.h>
+#include <EASTL/utility.h>
+#include <EASTL/vector.h>
+#include <ShockGraph/Core.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        class TaskGraph;
+
+        struct TaskSubgraphInfo {
+            eastl::string name = {};
+        };
+
+        /**
+         * @brief Structure shared by several copies of the same tasks with different resources, e.g. shadow cascades,
+         * reflection probes or per-view passes. Every copy is recorded between TaskGraph::BeginSubgraph() and EndSubgraph()
+         * with a binding table listing its resources in the same order for every copy.
+         * Build() analyses the dependencies of the first copy only, every other copy is that analysis plus its binding table:
+         * its tasks are not walked again and only the first and last use of each binding is resolved against the rest of the graph.
+         * Every copy still adds its own task objects, their callbacks capture the resources of the copy, so task memory and
+         * the per task work of scheduling and barriers still grow with the number of copies.
+         * Copies of a variant that runs only part of them, and graphs using resource versioning, are analysed task by task.
+         */
+        class TaskSubgraph : DeleteCopy, DeleteMove {
+        public:
+            SHOCKGRAPH_API TaskSubgraph(const TaskSubgraphInfo& info = {}) : mInfo(info) {}
+            SHOCKGRAPH_API ~TaskSubgraph() = default;
+
+            PYRO_NODISCARD PYRO_FORCEINLINE const TaskSubgraphInfo& Info() const { return mInfo; }
+
+        private:
+            TaskSubgraphInfo mInfo = {};
+
+            // analysis of the first copy of the last Build(). Slots are the bindings followed by the resources every copy shares
+            struct Template {
+                u32 taskCount = 0;
+                u32 bindingCount = 0;
+                // slot of every dependency in task and declaration order, only walked again to validate copies in debug builds
+                eastl::vector<u32> dependencySlots = {};
+                eastl::vector<u32> sharedResources = {};
+                // reduced dependencies between the tasks of a copy, indexed relative to its first task
+                eastl::vector<eastl::vector<TaskId>> localDependencies = {};
+                // first and last local task using every slot, the only uses the rest of the graph can depend on
+                eastl::vector<eastl::pair<u32, u32>> slotUsers = {};
+            };
+            Template mTemplate = {};
+            bool mbAnalysed = false;
+
+            friend class TaskGraph;
+        };
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,369 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "TaskTextureLoader.hpp"
+#include <PyroRHI/Api/Util.hpp>
+
+#include <EASTL/algorithm.h>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        // read-only mapping of a whole file, the pages are only faulted in while they are staged
+        class MappedFile : DeleteCopy, DeleteMove {
+        public:
+            explicit MappedFile(const eastl::string& path) {
+#ifdef _WIN32
+                mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+                if (mFile == INVALID_HANDLE_VALUE) {
+                    return;
+                }
+                LARGE_INTEGER size = {};
+                if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0) {
+                    return;
+                }
+                mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (!mMapping) {
+                    return;
+                }
+                mData = static_cast<const u8*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+                mSize = mData ? static_cast<usize>(size.QuadPart) : 0;
+#else
+                mFile = open(path.c_str(), O_RDONLY);
+                if (mFile < 0) {
+                    return;
+                }
+                struct stat status = {};
+                if (fstat(mFile, &status) != 0 || status.st_size == 0) {
+                    return;
+                }
+                void* data = mmap(nullptr, static_cast<usize>(status.st_size), PROT_READ, MAP_PRIVATE, mFile, 0);
+                if (data == MAP_FAILED) {
+                    return;
+                }
+                madvise(data, static_cast<usize>(status.st_size), MADV_SEQUENTIAL);
+                mData = static_cast<const u8*>(data);
+                mSize = static_cast<usize>(status.st_size);
+#endif
+            }
+            ~MappedFile() {
+#ifdef _WIN32
+                if (mData) {
+                    UnmapViewOfFile(mData);
+                }
+                if (mMapping) {
+                    CloseHandle(mMapping);
+                }
+                if (mFile != INVALID_HANDLE_VALUE) {
+                    CloseHandle(mFile);
+                }
+#else
+                if (mData) {
+                    munmap(const_cast<u8*>(mData), mSize);
+                }
+                if (mFile >= 0) {
+                    close(mFile);
+                }
+#endif
+            }
+
+            PYRO_NODISCARD eastl::span<const u8> Data() const { return { mData, mSize }; }
+
+        private:
+#ifdef _WIN32
+            HANDLE mFile = INVALID_HANDLE_VALUE;
+            HANDLE mMapping = nullptr;
+#else
+            int mFile = -1;
+#endif
+            const u8* mData = nullptr;
+            usize mSize = 0;
+        };
+
+        template <typename T>
+        static T ReadLE(eastl::span<const u8> data, usize offset) {
+            T value = {};
+            memcpy(&value, data.data() + offset, sizeof(T));
+            return value;
+        }
+
+        struct ContainerFormat {
+            u32 code;
+            Format format;
+        };
+        // VkFormat values of KTX2 files
+        static constexpr ContainerFormat KTX2_FORMATS[] = {
+            { 9, Format::R8Unorm },
+            { 16, Format::RG8Unorm },
+            { 37, Format::RGBA8Unorm },
+            { 43, Format::RGBA8Srgb },
+            { 44, Format::BGRA8Unorm },
+            { 50, Format::BGRA8Srgb },
+            { 97, Format::RGBA16Sfloat },
+            { 103, Format::RG32Sfloat },
+            { 109, Format::RGBA32Sfloat },
+            { 133, Format::BC1RGBAUnorm },
+            { 134, Format::BC1RGBASrgb },
+            { 135, Format::BC2Unorm },
+            { 136, Format::BC2Srgb },
+            { 137, Format::BC3Unorm },
+            { 138, Format::BC3Srgb },
+            { 139, Format::BC4Unorm },
+            { 140, Format::BC4Snorm },
+            { 141, Format::BC5Unorm },
+            { 142, Format::BC5Snorm },
+            { 143, Format::BC6HUfloat },
+            { 144, Format::BC6HSfloat },
+            { 145, Format::BC7Unorm },
+            { 146, Format::BC7Srgb },
+            { 157, Format::ASTC4x4Unorm },
+            { 158, Format::ASTC4x4Srgb },
+            { 165, Format::ASTC6x6Unorm },
+            { 166, Format::ASTC6x6Srgb },
+            { 171, Format::ASTC8x8Unorm },
+            { 172, Format::ASTC8x8Srgb },
+        };
+        // DXGI_FORMAT values of DDS files with a DX10 header
+        static constexpr ContainerFormat DXGI_FORMATS[] = {
+            { 2, Format::RGBA32Sfloat },
+            { 10, Format::RGBA16Sfloat },
+            { 16, Format::RG32Sfloat },
+            { 28, Format::RGBA8Unorm },
+            { 29, Format::RGBA8Srgb },
+            { 49, Format::RG8Unorm },
+            { 61, Format::R8Unorm },
+            { 71, Format::BC1RGBAUnorm },
+            { 72, Format::BC1RGBASrgb },
+            { 74, Format::BC2Unorm },
+            { 75, Format::BC2Srgb },
+            { 77, Format::BC3Unorm },
+            { 78, Format::BC3Srgb },
+            { 80, Format::BC4Unorm },
+            { 81, Format::BC4Snorm },
+            { 83, Format::BC5Unorm },
+            { 84, Format::BC5Snorm },
+            { 87, Format::BGRA8Unorm },
+            { 91, Format::BGRA8Srgb },
+            { 95, Format::BC6HUfloat },
+            { 96, Format::BC6HSfloat },
+            { 98, Format::BC7Unorm },
+            { 99, Format::BC7Srgb },
+        };
+        template <usize N>
+        static bool FindFormat(const ContainerFormat (&formats)[N], u32 code, Format& format) {
+            for (const ContainerFormat& entry : formats) {
+                if (entry.code == code) {
+                    format = entry.format;
+                    return true;
+                }
+            }
+            return false;
+        }
+        static constexpr u32 FourCC(char a, char b, char c, char d) {
+            return static_cast<u32>(a) | static_cast<u32>(b) << 8 | static_cast<u32>(c) << 16 | static_cast<u32>(d) << 24;
+        }
+
+        static usize SubresourceSize(const TaskImageInfo& info, u32 mip) {
+            const RHIUtil::FormatBlockInfo blockInfo = RHIUtil::GetFormatBlockInfo(info.format);
+            const u32 blocksX = (eastl::max(info.size.width >> mip, 1U) + blockInfo.blockWidth - 1) / blockInfo.blockWidth;
+            const u32 blocksY = (eastl::max(info.size.height >> mip, 1U) + blockInfo.blockHeight - 1) / blockInfo.blockHeight;
+            return static_cast<usize>(blocksX) * blockInfo.bytesPerBlock * blocksY;
+        }
+
+        static bool ParseKtx2(eastl::span<const u8> data, TaskTextureContainer& container) {
+            constexpr usize HEADER_SIZE = 80;
+            constexpr usize LEVEL_INDEX_ENTRY_SIZE = 24;
+            if (data.size() < HEADER_SIZE) {
+                return false;
+            }
+            const u32 vkFormat = ReadLE<u32>(data, 12);
+            const u32 width = ReadLE<u32>(data, 20);
+            const u32 height = ReadLE<u32>(data, 24);
+            const u32 depth = ReadLE<u32>(data, 28);
+            const u32 layerCount = eastl::max(ReadLE<u32>(data, 32), 1U);
+            const u32 faceCount = ReadLE<u32>(data, 36);
+            const u32 levelCount = eastl::max(ReadLE<u32>(data, 40), 1U);
+            const u32 supercompressionScheme = ReadLE<u32>(data, 44);
+            if (supercompressionScheme != 0 || (faceCount != 1 && faceCount != 6) || width == 0 ||
+                data.size() < HEADER_SIZE + static_cast<usize>(levelCount) * LEVEL_INDEX_ENTRY_SIZE) {
+                return false;
+            }
+
+            TaskImageInfo& info = container.info;
+            if (!FindFormat(KTX2_FORMATS, vkFormat, info.format)) {
+                return false;
+            }
+            info.dimensions = depth > 0 ? ImageDimensions::e3D : height > 0 ? ImageDimensions::e2D : ImageDimensions::e1D;
+            info.flags = faceCount == 6 ? ImageCreateFlagBits::CUBE : ImageCreateFlagBits::NONE;
+            info.size = { width, eastl::max(height, 1U), eastl::max(depth, 1U) };
+            info.mipLevelCount = levelCount;
+            info.arrayLayerCount = layerCount * faceCount;
+
+            // every level holds all layers, faces and depth slices of its mip in that order
+            container.layout.clear();
+            for (u32 mip = 0; mip < levelCount; ++mip) {
+                const u64 levelOffset = ReadLE<u64>(data, HEADER_SIZE + mip * LEVEL_INDEX_ENTRY_SIZE);
+                const u64 levelLength = ReadLE<u64>(data, HEADER_SIZE + mip * LEVEL_INDEX_ENTRY_SIZE + 8);
+                const usize imageSize = SubresourceSize(info, mip) * eastl::max(info.size.depth >> mip, 1U);
+                if (levelOffset + levelLength > data.size() || levelLength < imageSize * info.arrayLayerCount) {
+                    return false;
+                }
+                for (u32 layer = 0; layer < info.arrayLayerCount; ++layer) {
+                    container.layout.push_back({
+                        .mipLevel = mip,
+                        .arrayLayer = layer,
+                        .offset = static_cast<usize>(levelOffset) + layer * imageSize,
+                    });
+                }
+            }
+            return true;
+        }
+
+        static bool ParseDds(eastl::span<const u8> data, TaskTextureContainer& container) {
+            constexpr usize HEADER_SIZE = 128;
+            constexpr usize DX10_HEADER_SIZE = 20;
+            constexpr u32 DDPF_FOURCC = 0x4;
+            constexpr u32 DDPF_RGB = 0x40;
+            constexpr u32 DDSCAPS2_CUBEMAP = 0x200;
+            constexpr u32 DDSCAPS2_VOLUME = 0x200000;
+            constexpr u32 DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+            constexpr u32 DDS_DIMENSION_TEXTURE1D = 2;
+            constexpr u32 DDS_DIMENSION_TEXTURE3D = 4;
+            if (data.size() < HEADER_SIZE) {
+                return false;
+            }
+            const u32 height = ReadLE<u32>(data, 12);
+            const u32 width = ReadLE<u32>(data, 16);
+            const u32 depth = ReadLE<u32>(data, 24);
+            const u32 mipCount = eastl::max(ReadLE<u32>(data, 28), 1U);
+            const u32 pixelFlags = ReadLE<u32>(data, 80);
+            const u32 fourCC = ReadLE<u32>(data, 84);
+            const u32 bitCount = ReadLE<u32>(data, 88);
+            const u32 redMask = ReadLE<u32>(data, 92);
+            const u32 caps2 = ReadLE<u32>(data, 112);
+
+            TaskImageInfo& info = container.info;
+            info.size = { width, eastl::max(height, 1U), 1 };
+            info.mipLevelCount = mipCount;
+            info.arrayLayerCount = 1;
+            info.dimensions = ImageDimensions::e2D;
+            info.flags = ImageCreateFlagBits::NONE;
+            usize dataOffset = HEADER_SIZE;
+            if ((pixelFlags & DDPF_FOURCC) && fourCC == FourCC('D', 'X', '1', '0')) {
+                if (data.size() < HEADER_SIZE + DX10_HEADER_SIZE) {
+                    return false;
+                }
+                const u32 dxgiFormat = ReadLE<u32>(data, 128);
+                const u32 resourceDimension = ReadLE<u32>(data, 132);
+                const u32 miscFlag = ReadLE<u32>(data, 136);
+                const u32 arraySize = eastl::max(ReadLE<u32>(data, 140), 1U);
+                if (!FindFormat(DXGI_FORMATS, dxgiFormat, info.format)) {
+                    return false;
+                }
+                info.arrayLayerCount = arraySize;
+                if (resourceDimension == DDS_DIMENSION_TEXTURE1D) {
+                    info.dimensions = ImageDimensions::e1D;
+                } else if (resourceDimension == DDS_DIMENSION_TEXTURE3D) {
+                    info.dimensions = ImageDimensions::e3D;
+                    info.size.depth = eastl::max(depth, 1U);
+                } else if (miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) {
+                    info.flags = ImageCreateFlagBits::CUBE;
+                    info.arrayLayerCount = arraySize * 6;
+                }
+                dataOffset += DX10_HEADER_SIZE;
+            } else {
+                if (pixelFlags & DDPF_FOURCC) {
+                    switch (fourCC) {
+                    case FourCC('D', 'X', 'T', '1'): info.format = Format::BC1RGBAUnorm; break;
+                    case FourCC('D', 'X', 'T', '3'): info.format = Format::BC2Unorm; break;
+                    case FourCC('D', 'X', 'T', '5'): info.format = Format::BC3Unorm; break;
+                    case FourCC('A', 'T', 'I', '1'):
+                    case FourCC('B', 'C', '4', 'U'): info.format = Format::BC4Unorm; break;
+                    case FourCC('A', 'T', 'I', '2'):
+                    case FourCC('B', 'C', '5', 'U'): info.format = Format::BC5Unorm; break;
+                    default: return false;
+                    }
+                } else if ((pixelFlags & DDPF_RGB) && bitCount == 32) {
+                    info.format = redMask == 0x000000FF ? Format::RGBA8Unorm : Format::BGRA8Unorm;
+                } else {
+                    return false;
+                }
+                if (caps2 & DDSCAPS2_CUBEMAP) {
+                    info.flags = ImageCreateFlagBits::CUBE;
+                    info.arrayLayerCount = 6;
+                } else if (caps2 & DDSCAPS2_VOLUME) {
+                    info.dimensions = ImageDimensions::e3D;
+                    info.size.depth = eastl::max(depth, 1U);
+                }
+            }
+
+            // every layer holds its full mip chain
+            container.layout.clear();
+            usize offset = dataOffset;
+            for (u32 layer = 0; layer < info.arrayLayerCount; ++layer) {
+                for (u32 mip = 0; mip < info.mipLevelCount; ++mip) {
+                    container.layout.push_back({ .mipLevel = mip, .arrayLayer = layer, .offset = offset });
+                    offset += SubresourceSize(info, mip) * eastl::max(info.size.depth >> mip, 1U);
+                }
+            }
+            return offset <= data.size();
+        }
+
+        bool ParseTextureContainer(eastl::span<const u8> data, TaskTextureContainer& container) {
+            static constexpr u8 KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+            if (data.size() >= sizeof(KTX2_IDENTIFIER) && memcmp(data.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+                return ParseKtx2(data, container);
+            }
+            if (data.size() >= 4 && ReadLE<u32>(data, 0) == FourCC('D', 'D', 'S', ' ')) {
+                return ParseDds(data, container);
+            }
+            return false;
+        }
+
+        TaskImage LoadTexture(TaskResourceManager* resourceManager, const TaskTextureLoadInfo& info) {
+            MappedFile file{ info.path };
+            TaskTextureContainer container = {};
+            if (!ParseTextureContainer(file.Data(), container)) {
+                return nullptr;
+            }
+            container.info.usage = info.usage;
+            container.info.name = info.name.empty() ? info.path : info.name;
+            // rows are copied from the mapping straight into staging, the mapping is released once they are staged
+            return resourceManager->CreatePersistentImage(container.info, file.Data(), info.priority, container.layout);
+        }
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
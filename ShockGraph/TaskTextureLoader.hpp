@@ -0,0 +1,65 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "TaskResourceManager.hpp"
+#include <EASTL/span.h>
+#include <EASTL/string.h>
+#include <EASTL/vector.h>
+#include <ShockGraph/Core.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        struct TaskTextureLoadInfo {
+            /**
+             * @brief KTX2 or DDS file, the container is detected from its header.
+             */
+            eastl::string path = {};
+            ImageUsageFlags usage = ImageUsageFlagBits::SHADER_RESOURCE;
+            TaskUploadPriority priority = TaskUploadPriority::Normal;
+            /**
+             * @brief Name of the image, the path if empty.
+             */
+            eastl::string name = {};
+        };
+        /**
+         * @brief Image description and subresource layout of a texture container, offsets are relative to the container data.
+         */
+        struct TaskTextureContainer {
+            TaskImageInfo info = {};
+            eastl::vector<TaskImageSubresourceData> layout = {};
+        };
+
+        /**
+         * @brief Parses a KTX2 or DDS container in memory. Supercompressed KTX2 files are not supported.
+         * @return false if the container is malformed or its format is not supported.
+         */
+        PYRO_NODISCARD SHOCKGRAPH_API bool ParseTextureContainer(eastl::span<const u8> data, TaskTextureContainer& container);
+        /**
+         * @brief Memory-maps a KTX2 or DDS file and stages every mip level and array layer straight from the mapping.
+         * Safe to call from a streaming thread, the upload is queued like any other initial data.
+         * @return nullptr if the file cannot be read or parsed.
+         */
+        PYRO_NODISCARD SHOCKGRAPH_API TaskImage LoadTexture(TaskResourceManager* resourceManager, const TaskTextureLoadInfo& info);
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
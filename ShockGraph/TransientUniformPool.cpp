@@ -0,0 +1,105 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "TransientUniformPool.hpp"
+
+#include <EASTL/algorithm.h>
+#include <PyroRHI/Api/IDevice.hpp>
+#include <libassert/assert.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        TransientUniformPool::TransientUniformPool(IDevice* device, u32 framesInFlight)
+            : mDevice(device) {
+            mFrames.resize(framesInFlight);
+            mFramesSinceTrim.resize(framesInFlight, 0);
+        }
+        TransientUniformPool::~TransientUniformPool() {
+            Release();
+        }
+
+        void TransientUniformPool::BeginFrame(u32 frameIndex) {
+            ASSERT(frameIndex < mFrames.size(), "Frame index is out of range!");
+            mFrameIndex = frameIndex;
+            const bool bTrim = ++mFramesSinceTrim[frameIndex] >= TRIM_INTERVAL;
+            if (bTrim) {
+                mFramesSinceTrim[frameIndex] = 0;
+            }
+            for (SizeClass& sizeClass : mFrames[frameIndex]) {
+                sizeClass.peak = eastl::max(sizeClass.peak, sizeClass.used);
+                if (bTrim) {
+                    // the frame that last used the slot retired, buffers above the recent peak only served a spike
+                    for (u32 i = sizeClass.peak; i < sizeClass.uniforms.size(); ++i) {
+                        mDevice->DestroyDeferred(sizeClass.uniforms[i].buffer);
+                    }
+                    sizeClass.uniforms.resize(sizeClass.peak);
+                    sizeClass.peak = 0;
+                }
+                sizeClass.used = 0;
+            }
+        }
+
+        void TransientUniformPool::Resize(u32 framesInFlight) {
+            Release();
+            mFrames.clear();
+            mFrames.resize(framesInFlight);
+            mFramesSinceTrim.clear();
+            mFramesSinceTrim.resize(framesInFlight, 0);
+            mFrameIndex = 0;
+        }
+
+        TaskTransientUniform TransientUniformPool::Allocate(usize size) {
+            ASSERT(size <= Limits::MAX_UNIFORM_BUFFER_SIZE, "Ubos must be at most UINT16 bytes in size!");
+            u32 classIndex = 0;
+            while ((MIN_UNIFORM_SIZE << classIndex) < size) {
+                ++classIndex;
+            }
+            ASSERT(classIndex < SIZE_CLASS_COUNT);
+            SizeClass& sizeClass = mFrames[mFrameIndex][classIndex];
+            if (sizeClass.used == sizeClass.uniforms.size()) {
+                const usize classSize = eastl::min(MIN_UNIFORM_SIZE << classIndex, static_cast<usize>(Limits::MAX_UNIFORM_BUFFER_SIZE));
+                Buffer buffer = mDevice->CreateBuffer({
+                    .size = classSize,
+                    .usage = BufferUsageFlagBits::UNIFORM_BUFFER,
+                    .initialLayout = BufferLayout::ReadOnly,
+                    .allocationDomain = MemoryAllocationDomain::HostRandomWrite,
+                    .name = "Transient Uniform " + eastl::to_string(classSize) + "B (In Flight #" + eastl::to_string(mFrameIndex) + ")",
+                });
+                sizeClass.uniforms.push_back({ .buffer = buffer, .hostAddress = mDevice->BufferHostAddress(buffer), .size = classSize });
+            }
+            return sizeClass.uniforms[sizeClass.used++];
+        }
+
+        void TransientUniformPool::Release() {
+            for (FrameSlot& frame : mFrames) {
+                for (SizeClass& sizeClass : frame) {
+                    for (const TaskTransientUniform& uniform : sizeClass.uniforms) {
+                        mDevice->DestroyDeferred(uniform.buffer);
+                    }
+                    sizeClass.uniforms.clear();
+                    sizeClass.used = 0;
+                    sizeClass.peak = 0;
+                }
+            }
+        }
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
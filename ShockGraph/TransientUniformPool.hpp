@@ -0,0 +1,85 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <EASTL/array.h>
+#include <EASTL/vector.h>
+#include <PyroRHI/Api/Forward.hpp>
+#include <ShockGraph/Core.hpp>
+
+namespace PyroshockStudios {
+    inline namespace ShockGraph {
+        struct TaskTransientUniform {
+            Buffer buffer = PYRO_NULL_BUFFER;
+            /**
+             * @brief Persistently mapped, write the constants here before the frame is submitted.
+             */
+            u8* hostAddress = nullptr;
+            usize size = 0;
+        };
+
+        /**
+         * @brief Frame scoped uniform buffers for per draw constants. Every frame slot keeps host visible buffers in power of two size classes,
+         * an allocation takes the next unused buffer of its class and the whole slot is reset once the frame that used it retired.
+         * After the first frames an allocation is a cursor increment, buffers are only created when a frame needs more than any before.
+         * Buffers above the peak of the last TRIM_INTERVAL frames of a slot are released, so a single heavy frame does not pin its memory forever.
+         * Not thread safe, a task graph records on a single thread.
+         */
+        class TransientUniformPool : DeleteCopy, DeleteMove {
+        public:
+            TransientUniformPool(IDevice* device, u32 framesInFlight);
+            ~TransientUniformPool();
+
+            /**
+             * @brief Starts handing out the buffers of a frame slot, the previous frame recorded into it must have retired.
+             */
+            void BeginFrame(u32 frameIndex);
+            /**
+             * @brief Drops every buffer, the GPU must be done with all frames.
+             */
+            void Resize(u32 framesInFlight);
+
+            PYRO_NODISCARD SHOCKGRAPH_API TaskTransientUniform Allocate(usize size);
+
+        private:
+            // 256 bytes up to the largest uniform buffer
+            static constexpr usize MIN_UNIFORM_SIZE = 256;
+            static constexpr u32 SIZE_CLASS_COUNT = 9;
+            // frames of one slot between trims
+            static constexpr u32 TRIM_INTERVAL = 256;
+            struct SizeClass {
+                eastl::vector<TaskTransientUniform> uniforms = {};
+                u32 used = 0;
+                // most buffers a frame used since the last trim
+                u32 peak = 0;
+            };
+            using FrameSlot = eastl::array<SizeClass, SIZE_CLASS_COUNT>;
+            void Release();
+
+            IDevice* mDevice = nullptr;
+            eastl::vector<FrameSlot> mFrames = {};
+            eastl::vector<u32> mFramesSinceTrim = {};
+            u32 mFrameIndex = 0;
+        };
+    } // namespace ShockGraph
+} // namespace PyroshockStudios
@@ -0,0 +1,133 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define PYRO_IMPLEMENT_NEW_OPERATOR
+#include <PyroCommon/MemoryOverload.hpp>
+
+#include <PyroCommon/Logger.hpp>
+#include <PyroRHI/Api/Util.hpp>
+#include <ShockGraph/StagingCopyPool.hpp>
+
+#include <EASTL/sort.h>
+#include <EASTL/algorithm.h>
+#include <EASTL/vector.h>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace PyroshockStudios;
+using namespace PyroshockStudios::Types;
+
+// Times StagingCopyPool::Copy against the copies it replaced, on RGBA8 images whose rows are either already aligned for
+// buffer to image copies (one contiguous copy) or tightly packed with a width that needs padding in staging (one copy per row).
+// The destination is ordinary cached memory, real staging pages are write-combined and favour streaming stores even more.
+namespace {
+    StdoutLogger* gSink = nullptr;
+
+    constexpr u32 ITERATIONS = 10;
+    constexpr usize ROW_ALIGNMENT = 256;
+    constexpr usize BYTES_PER_TEXEL = 4;
+
+    struct ImageCase {
+        const char* name = nullptr;
+        u32 width = 0;
+        u32 height = 0;
+    };
+
+    template <typename Fn>
+    f64 MedianMs(Fn&& copy) {
+        copy(); // warm up, faults in the destination pages
+        eastl::vector<f64> times = {};
+        for (u32 i = 0; i < ITERATIONS; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            copy();
+            times.push_back(std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        eastl::sort(times.begin(), times.end());
+        return times[ITERATIONS / 2];
+    }
+
+    bool RunCase(const ImageCase& image) {
+        const usize tightRowPitch = static_cast<usize>(image.width) * BYTES_PER_TEXEL;
+        const usize alignedRowPitch = (tightRowPitch + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+        eastl::vector<u8> src(tightRowPitch * image.height);
+        for (usize i = 0; i < src.size(); ++i) {
+            src[i] = static_cast<u8>(i * 31 + (i >> 12));
+        }
+        eastl::vector<u8> expected(alignedRowPitch * image.height, 0);
+        eastl::vector<u8> dst(alignedRowPitch * image.height, 0);
+        const StagingCopyRegion region = {
+            .src = src.data(),
+            .dst = dst.data(),
+            .srcRowPitch = tightRowPitch,
+            .dstRowPitch = alignedRowPitch,
+            .rowSize = tightRowPitch,
+            .rowCount = image.height,
+        };
+
+        const f64 memcpyMs = MedianMs([&] {
+            if (tightRowPitch == alignedRowPitch) {
+                memcpy(expected.data(), src.data(), src.size());
+            } else {
+                for (u32 row = 0; row < image.height; ++row) {
+                    memcpy(expected.data() + row * alignedRowPitch, src.data() + row * tightRowPitch, tightRowPitch);
+                }
+            }
+        });
+        const f64 rhiUtilMs = MedianMs([&] {
+            RHIUtil::CopyAlignedTextureData(src.data(), dst.data(), static_cast<u32>(tightRowPitch), image.height, 1, static_cast<u32>(alignedRowPitch));
+        });
+        bool bPassed = memcmp(dst.data(), expected.data(), dst.size()) == 0;
+
+        const f64 gigabytes = static_cast<f64>(src.size()) / (1024.0 * 1024.0 * 1024.0);
+        Logger::Info(gSink, "{} ({:.0f} MiB, row pitch {} -> {}): memcpy {:.2f} ms ({:.2f} GiB/s), CopyAlignedTextureData {:.2f} ms", image.name,
+            gigabytes * 1024.0, tightRowPitch, alignedRowPitch, memcpyMs, gigabytes / (memcpyMs / 1000.0), rhiUtilMs);
+        const u32 workerCounts[] = { 0, 2, eastl::max(std::thread::hardware_concurrency(), 2U) - 1 };
+        for (u32 workerCount : workerCounts) {
+            StagingCopyPool pool(workerCount);
+            eastl::fill(dst.begin(), dst.end(), u8(0));
+            const f64 poolMs = MedianMs([&] { pool.Copy({ &region, 1 }); });
+            bPassed &= memcmp(dst.data(), expected.data(), dst.size()) == 0;
+            Logger::Info(gSink, "{}: StagingCopyPool with {} workers {:.2f} ms ({:.2f}x memcpy)", image.name, workerCount, poolMs, memcpyMs / poolMs);
+        }
+        if (!bPassed) {
+            Logger::Error(gSink, "{}: copies do not match memcpy", image.name);
+        }
+        return bPassed;
+    }
+} // namespace
+
+int main(i32 argc, char** argv) {
+    gSink = new StdoutLogger("STAGINGCOPY");
+    const ImageCase images[] = {
+        { .name = "4K aligned", .width = 4096, .height = 4096 },
+        { .name = "4K padded", .width = 4095, .height = 4096 },
+        { .name = "8K aligned", .width = 8192, .height = 8192 },
+        { .name = "8K padded", .width = 8191, .height = 8192 },
+    };
+    bool bPassed = true;
+    for (const ImageCase& image : images) {
+        bPassed &= RunCase(image);
+    }
+    delete gSink;
+    return bPassed ? 0 : 1;
+}
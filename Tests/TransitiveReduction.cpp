@@ -0,0 +1,160 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define PYRO_IMPLEMENT_NEW_OPERATOR
+#include <PyroCommon/MemoryOverload.hpp>
+
+#include <PyroCommon/Logger.hpp>
+#include <ShockGraph/TaskGraph.hpp>
+
+#include <EASTL/algorithm.h>
+#include <EASTL/vector.h>
+#include <random>
+
+using namespace PyroshockStudios;
+using namespace PyroshockStudios::Types;
+
+// Builds seeded random DAGs in the shape task graphs take (mostly short range dependencies with a few long ones,
+// lots of redundant edges), reduces them and checks that the closure is unchanged and that no edge is left redundant.
+namespace {
+    StdoutLogger* gSink = nullptr;
+
+    struct GraphShape {
+        u32 taskCount = 0;
+        u32 maxParents = 0;
+        // chance of a parent anywhere before the task instead of within localRange tasks
+        f64 farChance = 0.0;
+        u32 localRange = 0;
+    };
+
+    eastl::vector<TaskDebugEdges> MakeRandomGraph(u64 seed, const GraphShape& shape) {
+        std::mt19937_64 rng(seed);
+        eastl::vector<TaskDebugEdges> edges(shape.taskCount);
+        for (u32 child = 1; child < shape.taskCount; ++child) {
+            const u32 parentCount = std::uniform_int_distribution<u32>(0, shape.maxParents)(rng);
+            for (u32 i = 0; i < parentCount; ++i) {
+                const u32 nearest = child > shape.localRange ? child - shape.localRange : 0;
+                const bool bFar = std::bernoulli_distribution(shape.farChance)(rng);
+                const TaskId parent = std::uniform_int_distribution<u32>(bFar ? 0 : nearest, child - 1)(rng);
+                if (eastl::find(edges[child].dependencies.begin(), edges[child].dependencies.end(), parent) == edges[child].dependencies.end()) {
+                    edges[child].dependencies.push_back(parent);
+                }
+            }
+        }
+        for (u32 child = 0; child < shape.taskCount; ++child) {
+            for (TaskId parent : edges[child].dependencies) {
+                edges[parent].dependents.push_back(child);
+            }
+        }
+        return edges;
+    }
+
+    // one row of words per task with a bit set for every task it transitively depends on, independent of the reduction
+    eastl::vector<u64> ComputeClosure(const eastl::vector<TaskDebugEdges>& edges) {
+        const usize wordCount = (edges.size() + 63) / 64;
+        eastl::vector<u64> closure(edges.size() * wordCount, 0);
+        for (usize child = 0; child < edges.size(); ++child) {
+            for (TaskId parent : edges[child].dependencies) {
+                for (usize word = 0; word < wordCount; ++word) {
+                    closure[child * wordCount + word] |= closure[parent * wordCount + word];
+                }
+                closure[child * wordCount + parent / 64] |= 1ull << (parent % 64);
+            }
+        }
+        return closure;
+    }
+
+    bool CheckGraph(u64 seed, const GraphShape& shape) {
+        eastl::vector<TaskDebugEdges> edges = MakeRandomGraph(seed, shape);
+        usize edgeCount = 0;
+        for (const TaskDebugEdges& edge : edges) {
+            edgeCount += edge.dependencies.size();
+        }
+        const eastl::vector<u64> closure = ComputeClosure(edges);
+
+        ReduceTransitiveEdges(edges);
+        const usize wordCount = (edges.size() + 63) / 64;
+        usize reducedEdgeCount = 0;
+        for (usize child = 0; child < edges.size(); ++child) {
+            const auto& parents = edges[child].dependencies;
+            reducedEdgeCount += parents.size();
+            if (!eastl::is_sorted(parents.begin(), parents.end())) {
+                Logger::Error(gSink, "Seed {}: dependencies of task {} are not sorted", seed, child);
+                return false;
+            }
+            for (TaskId parent : parents) {
+                const auto& dependents = edges[parent].dependents;
+                if (eastl::find(dependents.begin(), dependents.end(), static_cast<TaskId>(child)) == dependents.end()) {
+                    Logger::Error(gSink, "Seed {}: task {} is missing dependent {}", seed, parent, child);
+                    return false;
+                }
+                // minimal: no other parent may already reach this one
+                for (TaskId other : parents) {
+                    if (other != parent && (closure[other * wordCount + parent / 64] & (1ull << (parent % 64)))) {
+                        Logger::Error(gSink, "Seed {}: edge {} -> {} is implied through {}", seed, parent, child, other);
+                        return false;
+                    }
+                }
+            }
+        }
+        if (ComputeClosure(edges) != closure) {
+            Logger::Error(gSink, "Seed {}: reduction changed the closure", seed);
+            return false;
+        }
+        if (!HasReachability(edges, closure)) {
+            Logger::Error(gSink, "Seed {}: HasReachability rejected an unchanged closure", seed);
+            return false;
+        }
+        // every edge left is needed, so dropping any of them must be caught
+        for (usize child = edges.size(); child-- > 0;) {
+            if (!edges[child].dependencies.empty()) {
+                edges[child].dependencies.pop_back();
+                if (HasReachability(edges, closure)) {
+                    Logger::Error(gSink, "Seed {}: HasReachability accepted a graph missing a dependency of task {}", seed, child);
+                    return false;
+                }
+                break;
+            }
+        }
+        Logger::Info(gSink, "Seed {}: {} tasks, {} edges reduced to {}", seed, shape.taskCount, edgeCount, reducedEdgeCount);
+        return true;
+    }
+} // namespace
+
+int main(i32 argc, char** argv) {
+    gSink = new StdoutLogger("TRANSITIVEREDUCTION");
+    const GraphShape shapes[] = {
+        { .taskCount = 1, .maxParents = 0, .farChance = 0.0, .localRange = 1 },
+        { .taskCount = 64, .maxParents = 8, .farChance = 0.5, .localRange = 4 },
+        { .taskCount = 2000, .maxParents = 6, .farChance = 0.1, .localRange = 16 },
+        { .taskCount = 4096, .maxParents = 12, .farChance = 0.05, .localRange = 64 },
+        { .taskCount = 5000, .maxParents = 3, .farChance = 1.0, .localRange = 1 },
+    };
+    bool bPassed = true;
+    for (u64 seed = 1; seed <= 8; ++seed) {
+        for (const GraphShape& shape : shapes) {
+            bPassed &= CheckGraph(seed * 0x9E3779B97F4A7C15ULL, shape);
+        }
+    }
+    delete gSink;
+    return bPassed ? 0 : 1;
+}
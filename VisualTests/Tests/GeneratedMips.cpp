@@ -0,0 +1,127 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "GeneratedMips.hpp"
+
+namespace VisualTests {
+    static constexpr u32 TEXTURE_SIZE = 256;
+    static constexpr u32 MIP_COUNT = 9;
+    static constexpr u32 LAYER_COUNT = 2;
+
+    void GeneratedMips::CreateResources(const CreateResourceInfo& info) {
+        mipsCsh = info.shaderCompiler.CompileShaderFromFile("resources/Shaders/GenerateMips.slang",
+            { .stage = ShaderStage::Compute, .entryPoint = "generateMipsMain", .name = "Generate Mips Csh" });
+        mipsPipeline = info.resourceManager.CreateComputePipeline(
+            { .name = "Generate Mips Pipeline" },
+            { .program = mipsCsh });
+        info.resourceManager.SetMipGenerationPipeline(mipsPipeline);
+
+        // only mip 0 of each layer is uploaded. Layer 0 is a one texel checkerboard that has to fade to even grey,
+        // layer 1 has large red and blue blocks that have to blend into purple in the smallest levels
+        eastl::vector<u8> textureData = {};
+        for (u32 layer = 0; layer < LAYER_COUNT; ++layer) {
+            for (u32 y = 0; y < TEXTURE_SIZE; ++y) {
+                for (u32 x = 0; x < TEXTURE_SIZE; ++x) {
+                    const u32 cell = layer == 0 ? 1 : 32;
+                    const bool isCol = ((x / cell) % 2) == ((y / cell) % 2);
+                    if (layer == 0) {
+                        const u8 value = isCol ? 255 : 0;
+                        textureData.insert(textureData.end(), { value, value, value, 255 });
+                    } else {
+                        textureData.insert(textureData.end(), { static_cast<u8>(isCol ? 255 : 0), 0, static_cast<u8>(isCol ? 0 : 255), 255 });
+                    }
+                }
+            }
+        }
+
+        texture = info.resourceManager.CreatePersistentImage(
+            {
+                .format = Format::RGBA8Unorm,
+                .size = { TEXTURE_SIZE, TEXTURE_SIZE },
+                .mipLevelCount = MIP_COUNT,
+                .arrayLayerCount = LAYER_COUNT,
+                .usage = ImageUsageFlagBits::SHADER_RESOURCE,
+                .bGenerateMips = true,
+                .name = "Generated Mips Input",
+            },
+            { textureData.cbegin(), textureData.cend() });
+        textureView = info.resourceManager.DefaultShaderResourceView(texture);
+        sampler = info.resourceManager.CreateSampler({ .name = "Generated Mips Sampler" });
+
+        target = info.resourceManager.CreateColorTarget({
+            .image = info.swapChainImage,
+            .name = "Generated Mips RT",
+        });
+        vsh = info.shaderCompiler.CompileShaderFromFile("resources/VisualTests/Shaders/MipArrayUpload.slang",
+            { .stage = ShaderStage::Vertex, .entryPoint = "vertexMain", .name = "Generated Mips Vsh" });
+        fsh = info.shaderCompiler.CompileShaderFromFile("resources/VisualTests/Shaders/MipArrayUpload.slang",
+            { .stage = ShaderStage::Fragment, .entryPoint = "fragmentMain", .name = "Generated Mips Fsh" });
+        pipeline = info.resourceManager.CreateRasterPipeline(
+            {
+                .colorTargetStates = { { .format = info.swapChainImage->Info().format } },
+                .name = "Raster Pipeline",
+            },
+            {
+                .vertexShaderInfo = { TaskShaderInfo{ .program = vsh } },
+                .fragmentShaderInfo = { TaskShaderInfo{ .program = fsh } },
+            });
+    }
+    void GeneratedMips::ReleaseResources(const ReleaseResourceInfo& info) {
+        info.resourceManager.ReleaseShaderResourceView(textureView);
+        texture = {};
+        info.resourceManager.ReleaseSampler(sampler);
+        info.resourceManager.SetMipGenerationPipeline({});
+        target = {};
+        vsh = {}; fsh = {}; mipsCsh = {};
+        pipeline = {};
+        mipsPipeline = {};
+    }
+    eastl::span<GenericTask*> GeneratedMips::CreateTasks() {
+        tasks = {
+            new GraphicsCallbackTask(
+                { .name = "Generated Mips", .color = LabelColor::GREEN },
+                [this](GraphicsTask& task) {
+                    task.BindColorTarget({
+                        .target = target,
+                        .clear = { { 0.0f, 0.0f, 0.0f, 1.0f } },
+                    });
+                },
+                [this](TaskCommandList& commands) {
+                    commands.SetRasterPipeline(pipeline);
+                    struct Push {
+                        u32 Texture;
+                        u32 Sampler;
+                        u32 MipCount;
+                        u32 LayerCount;
+                    };
+                    commands.PushConstant<Push>({
+                        .Texture = textureView.index,
+                        .Sampler = sampler.index,
+                        .MipCount = MIP_COUNT,
+                        .LayerCount = LAYER_COUNT,
+                    });
+                    commands.Draw({ .vertexCount = 6, .instanceCount = MIP_COUNT * LAYER_COUNT });
+                })
+        };
+        return tasks;
+    }
+} // namespace VisualTests
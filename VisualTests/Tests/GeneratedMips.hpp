@@ -0,0 +1,52 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+#include <VisualTests/IVisualTest.hpp>
+
+
+namespace VisualTests {
+    class GeneratedMips : public IVisualTest, DeleteCopy, DeleteMove {
+        eastl::string Title() const override { return "Generated Mips"; }
+
+        void CreateResources(const CreateResourceInfo& info) override;
+        void ReleaseResources(const ReleaseResourceInfo& info) override;
+        eastl::span<GenericTask*> CreateTasks() override;
+
+        bool UseTaskGraph() const override { return true; }
+
+        bool TaskSupported(IDevice* device) override { return true; }
+
+    private:
+        TaskColorTarget target;
+
+        TaskImage texture;
+        ShaderResourceId textureView;
+        SamplerId sampler;
+
+        TaskShader vsh, fsh, mipsCsh;
+        TaskRasterPipeline pipeline;
+        TaskComputePipeline mipsPipeline;
+
+        eastl::vector<GenericTask*> tasks = {};
+    };
+} // namespace VisualTests
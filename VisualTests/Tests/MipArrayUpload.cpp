@@ -0,0 +1,127 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "MipArrayUpload.hpp"
+
+namespace VisualTests {
+    static constexpr u32 TEXTURE_SIZE = 64;
+    static constexpr u32 MIP_COUNT = 7;
+    static constexpr u32 LAYER_COUNT = 2;
+
+    void MipArrayUpload::CreateResources(const CreateResourceInfo& info) {
+        // every mip level gets its own colour, layer 1 the inverse of layer 0, with a checkerboard so each level shows its resolution
+        static constexpr u8 MIP_COLORS[MIP_COUNT][3] = {
+            { 255, 0, 0 },
+            { 255, 128, 0 },
+            { 255, 255, 0 },
+            { 0, 255, 0 },
+            { 0, 255, 255 },
+            { 0, 0, 255 },
+            { 255, 0, 255 },
+        };
+        // tightly packed, every mip level of layer 0 first, then those of layer 1
+        eastl::vector<u8> textureData = {};
+        for (u32 layer = 0; layer < LAYER_COUNT; ++layer) {
+            for (u32 mip = 0; mip < MIP_COUNT; ++mip) {
+                const u32 size = TEXTURE_SIZE >> mip;
+                for (u32 y = 0; y < size; ++y) {
+                    for (u32 x = 0; x < size; ++x) {
+                        const bool isCol = ((x / 2) % 2) == ((y / 2) % 2);
+                        for (u32 c = 0; c < 3; ++c) {
+                            const u8 color = layer == 0 ? MIP_COLORS[mip][c] : static_cast<u8>(255 - MIP_COLORS[mip][c]);
+                            textureData.push_back(isCol ? color : color / 2);
+                        }
+                        textureData.push_back(255);
+                    }
+                }
+            }
+        }
+
+        texture = info.resourceManager.CreatePersistentImage(
+            {
+                .format = Format::RGBA8Unorm,
+                .size = { TEXTURE_SIZE, TEXTURE_SIZE },
+                .mipLevelCount = MIP_COUNT,
+                .arrayLayerCount = LAYER_COUNT,
+                .usage = ImageUsageFlagBits::SHADER_RESOURCE,
+                .name = "Mip Array Upload Input",
+            },
+            { textureData.cbegin(), textureData.cend() });
+        textureView = info.resourceManager.DefaultShaderResourceView(texture);
+        sampler = info.resourceManager.CreateSampler({ .name = "Mip Array Upload Sampler" });
+
+        target = info.resourceManager.CreateColorTarget({
+            .image = info.swapChainImage,
+            .name = "Mip Array Upload RT",
+        });
+        vsh = info.shaderCompiler.CompileShaderFromFile("resources/VisualTests/Shaders/MipArrayUpload.slang",
+            { .stage = ShaderStage::Vertex, .entryPoint = "vertexMain", .name = "Mip Array Upload Vsh" });
+        fsh = info.shaderCompiler.CompileShaderFromFile("resources/VisualTests/Shaders/MipArrayUpload.slang",
+            { .stage = ShaderStage::Fragment, .entryPoint = "fragmentMain", .name = "Mip Array Upload Fsh" });
+        pipeline = info.resourceManager.CreateRasterPipeline(
+            {
+                .colorTargetStates = { { .format = info.swapChainImage->Info().format } },
+                .name = "Raster Pipeline",
+            },
+            {
+                .vertexShaderInfo = { TaskShaderInfo{ .program = vsh } },
+                .fragmentShaderInfo = { TaskShaderInfo{ .program = fsh } },
+            });
+    }
+    void MipArrayUpload::ReleaseResources(const ReleaseResourceInfo& info) {
+        info.resourceManager.ReleaseShaderResourceView(textureView);
+        texture = {};
+        info.resourceManager.ReleaseSampler(sampler);
+        target = {};
+        vsh = {}; fsh = {};
+        pipeline = {};
+    }
+    eastl::span<GenericTask*> MipArrayUpload::CreateTasks() {
+        tasks = {
+            new GraphicsCallbackTask(
+                { .name = "Mip Array Upload", .color = LabelColor::GREEN },
+                [this](GraphicsTask& task) {
+                    task.BindColorTarget({
+                        .target = target,
+                        .clear = { { 0.0f, 0.0f, 0.0f, 1.0f } },
+                    });
+                },
+                [this](TaskCommandList& commands) {
+                    commands.SetRasterPipeline(pipeline);
+                    struct Push {
+                        u32 Texture;
+                        u32 Sampler;
+                        u32 MipCount;
+                        u32 LayerCount;
+                    };
+                    commands.PushConstant<Push>({
+                        .Texture = textureView.index,
+                        .Sampler = sampler.index,
+                        .MipCount = MIP_COUNT,
+                        .LayerCount = LAYER_COUNT,
+                    });
+                    commands.Draw({ .vertexCount = 6, .instanceCount = MIP_COUNT * LAYER_COUNT });
+                })
+        };
+        return tasks;
+    }
+} // namespace VisualTests
@@ -0,0 +1,92 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "TransientUniforms.hpp"
+
+#include <cmath>
+
+namespace VisualTests {
+    static constexpr u32 TRIANGLE_COUNT = 3;
+
+    struct TriangleConstants {
+        float colors[3][4];
+        float offset[4];
+    };
+
+    void TransientUniforms::CreateResources(const CreateResourceInfo& info) {
+        target = info.resourceManager.CreateColorTarget({
+            .image = info.swapChainImage,
+            .name = "Transient Uniforms RT",
+        });
+        vsh = info.shaderCompiler.CompileShaderFromFile("resources/VisualTests/Shaders/TransientUniforms.slang",
+            { .stage = ShaderStage::Vertex, .entryPoint = "vertexMain", .name = "Transient Uniforms Vsh" });
+        fsh = info.shaderCompiler.CompileShaderFromFile("resources/VisualTests/Shaders/TransientUniforms.slang",
+            { .stage = ShaderStage::Fragment, .entryPoint = "fragmentMain", .name = "Transient Uniforms Fsh" });
+        pipeline = info.resourceManager.CreateRasterPipeline(
+            {
+                .colorTargetStates = { { .format = info.swapChainImage->Info().format } },
+                .name = "Raster Pipeline",
+            },
+            {
+                .vertexShaderInfo = { TaskShaderInfo{ .program = vsh } },
+                .fragmentShaderInfo = { TaskShaderInfo{ .program = fsh } },
+            });
+    }
+    void TransientUniforms::ReleaseResources(const ReleaseResourceInfo& info) {
+        target = {};
+        vsh = {}; fsh = {};
+        pipeline = {};
+    }
+    eastl::span<GenericTask*> TransientUniforms::CreateTasks() {
+        tasks = {
+            new GraphicsCallbackTask(
+                { .name = "Transient Uniforms", .color = LabelColor::GREEN },
+                [this](GraphicsTask& task) {
+                    task.BindColorTarget({
+                        .target = target,
+                        .clear = { { 0.0f, 0.0f, 0.0f, 1.0f } },
+                    });
+                },
+                [this](TaskCommandList& commands) {
+                    static float time = 0.0f;
+                    commands.SetRasterPipeline(pipeline);
+                    // every draw gets its own constants, a reused buffer would show the last triangle's colours on all of them
+                    for (u32 i = 0; i < TRIANGLE_COUNT; ++i) {
+                        TriangleConstants constants = {};
+                        for (u32 v = 0; v < 3; ++v) {
+                            const float phase = time + static_cast<float>(i) * 2.0f + static_cast<float>(v) * 2.094f;
+                            constants.colors[v][0] = 0.5f + 0.5f * sinf(phase);
+                            constants.colors[v][1] = 0.5f + 0.5f * sinf(phase + 2.094f);
+                            constants.colors[v][2] = 0.5f + 0.5f * sinf(phase + 4.189f);
+                            constants.colors[v][3] = 1.0f;
+                        }
+                        constants.offset[0] = -0.6f + 0.6f * static_cast<float>(i);
+                        constants.offset[1] = 0.2f * sinf(time + static_cast<float>(i));
+                        commands.SetUniformData(0, constants);
+                        commands.Draw({ .vertexCount = 3 });
+                    }
+                    time += 1.0f / 60.0f;
+                })
+        };
+        return tasks;
+    }
+} // namespace VisualTests
@@ -0,0 +1,142 @@
+// MIT License
+//
+// Copyright (c) 2025 Pyroshock Studios
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "UploadRowPitch.hpp"
+
+namespace VisualTests {
+    // both images are larger than the threshold of the parallel staging copies
+    static constexpr u32 TEXTURE_HEIGHT = 1200;
+    static constexpr u32 ALIGNED_WIDTH = 1024;
+    static constexpr u32 UNALIGNED_WIDTH = 1000;
+    // source rows of the unaligned image carry 12 bytes of padding that must never reach the image
+    static constexpr u32 UNALIGNED_ROW_PITCH = UNALIGNED_WIDTH * 4 + 12;
+
+    // Diagonal stripes, a row copied with the wrong pitch shears them visibly
+    static eastl::vector<u8> MakeStripes(u32 width, u32 height, u32 rowPitch) {
+        eastl::vector<u8> data(static_cast<usize>(rowPitch) * height, 0);
+        for (u32 y = 0; y < height; ++y) {
+            u8* row = data.data() + static_cast<usize>(y) * rowPitch;
+            for (u32 x = 0; x < width; ++x) {
+                bool isCol = (((x + y) / 64) % 2) == 0;
+                row[x * 4 + 0] = isCol ? 255 : 0;   // R
+                row[x * 4 + 1] = isCol ? 0 : 255;   // G
+                row[x * 4 + 2] = isCol ? 255 : 0;   // B
+                row[x * 4 + 3] = 255;               // A
+            }
+            // padding shows up as solid red if it is ever uploaded
+            for (u32 i = width * 4; i < rowPitch; i += 4) {
+                row[i + 0] = 255;
+                row[i + 3] = 255;
+            }
+        }
+        return data;
+    }
+
+    void UploadRowPitch::CreateResources(const CreateResourceInfo& info) {
+        eastl::vector<u8> alignedData = MakeStripes(ALIGNED_WIDTH, TEXTURE_HEIGHT, ALIGNED_WIDTH * 4);
+        eastl::vector<u8> unalignedData = MakeStripes(UNALIGNED_WIDTH, TEXTURE_HEIGHT, UNALIGNED_ROW_PITCH);
+
+        alignedTexture = info.resourceManager.CreatePersistentImage(
+            {
+                .format = Format::RGBA8Unorm,
+                .size = { ALIGNED_WIDTH, TEXTURE_HEIGHT },
+                .usage = ImageUsageFlagBits::SHADER_RESOURCE,
+                .name = "Aligned Rows Texture",
+            },
+            { alignedData.cbegin(), alignedData.cend() });
+        const TaskImageSubresourceData unalignedLayout[] = {
+            { .mipLevel = 0, .arrayLayer = 0, .offset = 0, .rowPitch = UNALIGNED_ROW_PITCH },
+        };
+        unalignedTexture = info.resourceManager.CreatePersistentImage(
+            {
+                .format = Format::RGBA8Unorm,
+                .size = { UNALIGNED_WIDTH, TEXTURE_HEIGHT },
+                .usage = ImageUsageFlagBits::SHADER_RESOURCE,
+                .name = "Unaligned Rows Texture",
+            },
+            { unalignedData.cbegin(), unalignedData.cend() }, TaskUploadPriority::Normal, unalignedLayout);
+        alignedView = info.resourceManager.DefaultShaderResourceView(alignedTexture);
+        unalignedView = info.resourceManager.DefaultShaderResourceView(unalignedTexture);
+        sampler = info.resourceManager.CreateSampler({ .name = "Upload Row Pitch Sampler" });
+
+        target = info.resourceManager.CreateColorTarget({
+            .image = info.swapChainImage,
+            .name = "Upload Row Pitch RT",
+        });
+        vsh = info.shaderCompiler.CompileShaderFromFile("resources/VisualTests/Shaders/UploadRowPitch.slang",
+            { .stage = ShaderStage::Vertex, .entryPoint = "vertexMain", .name = "Upload Row Pitch Vsh" });
+        fsh = info.shaderCompiler.CompileShaderFromFile("resources/VisualTests/Shaders/UploadRowPitch.slang",
+            { .stage = ShaderStage::Fragment, .entryPoint = "fragmentMain", .name = "Upload Row Pitch Fsh" });
+        pipeline = info.resourceManager.CreateRasterPipeline(
+            {
+                .colorTargetStates = { { .format = info.swapChainImage->Info().format } },
+                .name = "Raster Pipeline",
+            },
+            {
+                .vertexShaderInfo = { TaskShaderInfo{ .program = vsh } },
+                .fragmentShaderInfo = { TaskShaderInfo{ .program = fsh } },
+            });
+    }
+    void UploadRowPitch::ReleaseResources(const ReleaseResourceInfo& info) {
+        info.resourceManager.ReleaseShaderResourceView(alignedView);
+        info.resourceManager.ReleaseShaderResourceView(unalignedView);
+        alignedTexture = {};
+        unalignedTexture = {};
+        info.resourceManager.ReleaseSampler(sampler);
+        target = {};
+        vsh = {}; fsh = {};
+        pipeline = {};
+    }
+    eastl::span<GenericTask*> UploadRowPitch::CreateTasks() {
+        tasks = {
+            new GraphicsCallbackTask(
+                { .name = "Upload Row Pitch", .color = LabelColor::GREEN },
+                [this](GraphicsTask& task) {
+                    task.BindColorTarget({
+                        .target = target,
+                        .clear = { { 0.0f, 0.0f, 0.0f, 1.0f } },
+                    });
+                },
+                [this](TaskCommandList& commands) {
+                    commands.SetRasterPipeline(pipeline);
+                    struct Push {
+                        u32 Texture;
+                        u32 Sampler;
+                        float OffsetX;
+                    };
+                    commands.PushConstant<Push>({
+                        .Texture = alignedView.index,
+                        .Sampler = sampler.index,
+                        .OffsetX = -0.45f,
+                    });
+                    commands.Draw({ .vertexCount = 6 });
+                    commands.PushConstant<Push>({
+                        .Texture = unalignedView.index,
+                        .Sampler = sampler.index,
+                        .OffsetX = 0.45f,
+                    });
+                    commands.Draw({ .vertexCount = 6 });
+                })
+        };
+        return tasks;
+    }
+} // namespace VisualTests
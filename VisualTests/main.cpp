@@ -35,17 +35,21 @@
 #include "Tests/RayQueryCompute.hpp"
 #include "Tests/RayQueryPixel.hpp"
 #include "Tests/DrawIndirect.hpp"
+#include "Tests/GeneratedMips.hpp"
 #include "Tests/GeometryShader.hpp"
 #include "Tests/HelloTexture.hpp"
 #include "Tests/HelloTriangle.hpp"
 #include "Tests/IndexBuffer.hpp"
 #include "Tests/InstanceBuffer.hpp"
 #include "Tests/MSAA.hpp"
+#include "Tests/MipArrayUpload.hpp"
 #include "Tests/PushConstants.hpp"
 #include "Tests/SpecialisationConstants.hpp"
 #include "Tests/TesselationShader.hpp"
+#include "Tests/TransientUniforms.hpp"
 #include "Tests/UniformBuffer.hpp"
 #include "Tests/UpdateBuffer.hpp"
+#include "Tests/UploadRowPitch.hpp"
 #include "Tests/VertexBuffer.hpp"
 #include "Tests/Wireframe.hpp"
 #include "Tests/WireframeSmooth.hpp"
@@ -91,6 +95,10 @@ int main(i32 argc, char** argv) {
     app->RegisterTest<VisualTests::UpdateBuffer>();
     app->RegisterTest<VisualTests::RayQueryPixel>();
     app->RegisterTest<VisualTests::RayQueryCompute>();
+    app->RegisterTest<VisualTests::UploadRowPitch>();
+    app->RegisterTest<VisualTests::MipArrayUpload>();
+    app->RegisterTest<VisualTests::GeneratedMips>();
+    app->RegisterTest<VisualTests::TransientUniforms>();
 
     app->Run();
 